@@ -25,11 +25,36 @@
  * For more information, please refer to <https://unlicense.org>
  */
 
+// For sched_setaffinity(), sched_getcpu() and RUSAGE_THREAD.
+#define _GNU_SOURCE
+
 #include "../utils/common.h"
 #include "../utils/gen_word.h"
+#include "../utils/prng.h"
 #include "../utils/fnv.h"
 
 #include "../jjhash.h"
+#include "../jjhashv.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+# define HAVE_TSC 1
+#else
+# define HAVE_TSC 0
+#endif
+
+#include <math.h>
+#include <sys/resource.h>
+
+#if defined(__linux__)
+# include <sched.h>
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# define HAVE_PERF 1
+#else
+# define HAVE_PERF 0
+#endif
 
 #define JJ(token) jjhash ## token
 
@@ -50,174 +75,1626 @@ static HASH_FUNC_ATTRS uint32_t hash_jj_b(const char *s, size_t ns)
     return JJ(_b)(s, ns);
 }
 
+static HASH_FUNC_ATTRS uint32_t hash_jj_b_short(const char *s, size_t ns)
+{
+    return JJ(_b_short)(s, ns);
+}
+
 static HASH_FUNC_ATTRS uint32_t hash_jj_s(const char *s)
 {
     return JJ(_s)(s);
 }
 
+#if JJHASHV_HAVE_SSE2
+// The kernel jjhashd_s() uses with JJHASH_KERNEL=sse2; the words are followed by other records, so its reads past
+// the terminator stay within the buffer.
+static HASH_FUNC_ATTRS uint32_t hash_jj_s_sse2(const char *s)
+{
+    return jjhashv_s_sse2(s);
+}
+#endif
+
 //-----------------------------------------------
 
-#ifndef BENCH_B
-#error "Please define BENCH_B."
-#endif
+// The words are stored one after another in records of 'stride' bytes, laid out as the 'Word' struct of the
+// compile-time version of this benchmark was: for pointer-and-length strings, the characters followed by the
+// length (one byte if 'stride <= 256', two otherwise); for null-terminated strings, the characters followed by
+// the terminator (and padding).
+typedef struct {
+    char *data;
+    size_t stride;
+    size_t size;
+    bool b;
+    size_t max_len;
+    size_t total_len;
+} Dict;
 
-#ifndef BENCH_NW
-#error "Please define BENCH_NW."
+static size_t dict_len_bytes(const Dict *D)
+{
+    return D->b ? (D->stride <= 256 ? 1 : 2) : 0;
+}
+
+static Dict dict_new(size_t capacity, size_t stride, bool b)
+{
+    return (Dict) {
+        .data = calloc_or_die(capacity, stride),
+        .stride = stride,
+        .size = 0,
+        .b = b,
+        .max_len = 0,
+        .total_len = 0,
+    };
+}
+
+static void dict_free(Dict *D)
+{
+    free(D->data);
+}
+
+static size_t dict_word_len(const Dict *D, size_t i)
+{
+    const char *w = D->data + i * D->stride;
+    size_t len_bytes = dict_len_bytes(D);
+    if (len_bytes == 1) {
+        return (uint8_t) w[D->stride - 1];
+    } else if (len_bytes == 2) {
+        uint16_t len;
+        memcpy(&len, w + D->stride - 2, 2);
+        return len;
+    }
+    return strnlen(w, D->stride);
+}
+
+static void dict_add(Dict *D, const char *s, size_t ns)
+{
+    char *dst = D->data + D->size++ * D->stride;
+    size_t len_bytes = dict_len_bytes(D);
+    assert(ns + (D->b ? len_bytes : 1) <= D->stride);
+
+    memcpy(dst, s, ns);
+    if (len_bytes == 1) {
+        dst[D->stride - 1] = ns;
+    } else if (len_bytes == 2) {
+        uint16_t len = ns;
+        memcpy(dst + D->stride - 2, &len, 2);
+    }
+
+    if (ns > D->max_len) {
+        D->max_len = ns;
+    }
+    D->total_len += ns;
+}
+
+// Runs one pass over the dictionary with a specific hash function. Each of these calls its hash function
+// directly, so that the only difference from the compile-time version is the indirect call per pass.
+typedef uint32_t (*RunFunc)(const Dict *D);
+
+#define DEFINE_RUN_B(Name_, LenType_) \
+    static uint32_t run_ ## Name_ ## _ ## LenType_(const Dict *D) \
+    { \
+        const char *w = D->data; \
+        const char *w_end = w + D->size * D->stride; \
+        size_t len_off = D->stride - sizeof(LenType_); \
+        uint32_t res = 0; \
+        for (; w != w_end; w += D->stride) { \
+            LenType_ len; \
+            memcpy(&len, w + len_off, sizeof(len)); \
+            res ^= hash_ ## Name_(w, len); \
+        } \
+        return res; \
+    }
+
+#define DEFINE_RUN_S(Name_) \
+    static uint32_t run_ ## Name_(const Dict *D) \
+    { \
+        const char *w = D->data; \
+        const char *w_end = w + D->size * D->stride; \
+        uint32_t res = 0; \
+        for (; w != w_end; w += D->stride) { \
+            res ^= hash_ ## Name_(w); \
+        } \
+        return res; \
+    }
+
+DEFINE_RUN_B(fnv_b, uint8_t)
+DEFINE_RUN_B(fnv_b, uint16_t)
+DEFINE_RUN_B(jj_b, uint8_t)
+DEFINE_RUN_B(jj_b, uint16_t)
+DEFINE_RUN_B(jj_b_short, uint8_t)
+DEFINE_RUN_B(jj_b_short, uint16_t)
+DEFINE_RUN_S(fnv_s)
+DEFINE_RUN_S(jj_s)
+#if JJHASHV_HAVE_SSE2
+DEFINE_RUN_S(jj_s_sse2)
 #endif
 
-#ifndef BENCH_NT
-#error "Please define BENCH_NT."
+static inline size_t record_len_uint8_t(const char *p)
+{
+    return (uint8_t) *p;
+}
+
+static inline size_t record_len_uint16_t(const char *p)
+{
+    uint16_t len;
+    memcpy(&len, p, sizeof(len));
+    return len;
+}
+
+// A working set much larger than the dictionary (and, usually, than the last-level cache): the records of the
+// dictionary are copied over and over into 'nslots' slots, each of them being the 8-byte offset of the next
+// slot in the chase order followed by the record.
+typedef enum {
+    ACCESS_SEQ,
+    ACCESS_RANDOM,
+    ACCESS_CHASE,
+} Access;
+
+static const char *const ACCESS_NAMES[] = {"seq", "random", "chase"};
+
+typedef struct {
+    char *base;
+    size_t slot_stride;
+    size_t nslots;
+    // For ACCESS_SEQ and ACCESS_RANDOM, the slots in the order of visiting (in increasing order, or a random
+    // permutation); the addresses of the keys are known in advance, so their cache misses may overlap, and the
+    // keys 'prefetch' slots ahead are prefetched (if it is not zero).
+    uint32_t *order;
+    size_t prefetch;
+    // For ACCESS_CHASE, the offset of the first slot; the slots form a single random cycle, and the address of
+    // each key is only known once the previous one has been loaded, as in a linked list.
+    uint64_t start;
+    size_t total_len;
+} WorkingSet;
+
+typedef uint32_t (*RunWsFunc)(const WorkingSet *W);
+
+#define DEFINE_RUN_WS_LOOP(Call_) \
+    { \
+        uint32_t res = 0; \
+        if (!W->order) { \
+            const char *p = W->base + W->start; \
+            for (size_t i = 0; i < W->nslots; ++i) { \
+                const char *w = p + 8; \
+                res ^= Call_; \
+                uint64_t next; \
+                memcpy(&next, p, sizeof(next)); \
+                p = W->base + next; \
+            } \
+        } else { \
+            for (size_t i = 0; i < W->nslots; ++i) { \
+                if (W->prefetch && i + W->prefetch < W->nslots) { \
+                    __builtin_prefetch(W->base + (size_t) W->order[i + W->prefetch] * W->slot_stride + 8); \
+                } \
+                const char *w = W->base + (size_t) W->order[i] * W->slot_stride + 8; \
+                res ^= Call_; \
+            } \
+        } \
+        return res; \
+    }
+
+#define DEFINE_RUN_WS_B(Name_, LenType_) \
+    static uint32_t run_ws_ ## Name_ ## _ ## LenType_(const WorkingSet *W) \
+    { \
+        size_t len_off = W->slot_stride - 8 - sizeof(LenType_); \
+        DEFINE_RUN_WS_LOOP(hash_ ## Name_(w, record_len_ ## LenType_(w + len_off))) \
+    }
+
+#define DEFINE_RUN_WS_S(Name_) \
+    static uint32_t run_ws_ ## Name_(const WorkingSet *W) \
+    DEFINE_RUN_WS_LOOP(hash_ ## Name_(w))
+
+DEFINE_RUN_WS_B(fnv_b, uint8_t)
+DEFINE_RUN_WS_B(fnv_b, uint16_t)
+DEFINE_RUN_WS_B(jj_b, uint8_t)
+DEFINE_RUN_WS_B(jj_b, uint16_t)
+DEFINE_RUN_WS_B(jj_b_short, uint8_t)
+DEFINE_RUN_WS_B(jj_b_short, uint16_t)
+DEFINE_RUN_WS_S(fnv_s)
+DEFINE_RUN_WS_S(jj_s)
+#if JJHASHV_HAVE_SSE2
+DEFINE_RUN_WS_S(jj_s_sse2)
 #endif
 
-#ifndef BENCH_FNV
-#error "Please define BENCH_FNV."
+#define BARRIER_NOTHING() \
+    asm volatile ("" ::: "memory")
+
+#define BARRIER(X_) \
+    do { \
+        uint64_t x__ = (X_); \
+        asm volatile ("" : : "r"(x__) : "memory"); \
+    } while (0)
+
+static inline uint64_t get_utime(void)
+{
+    BARRIER_NOTHING();
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t res = ((uint64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+
+    BARRIER(res);
+    return res;
+}
+
+// Reference cycles of the time stamp counter (not core cycles: they tick at a fixed rate, whatever the
+// frequency of the core), or 0 if there is no such counter.
+static inline uint64_t get_tsc(void)
+{
+    BARRIER_NOTHING();
+#if HAVE_TSC
+    uint64_t res = __rdtsc();
+#else
+    uint64_t res = 0;
 #endif
+    BARRIER(res);
+    return res;
+}
 
-#ifndef BENCH_WL
-#error "Please define BENCH_WL."
+// Timer for the latency mode: the time stamp counter, fenced so that the timed calls can neither start before
+// the first reading nor be still running at the second one; on other CPUs, nanoseconds.
+static inline uint64_t latency_timer_start(void)
+{
+#if HAVE_TSC
+    _mm_lfence();
+    uint64_t res = __rdtsc();
+    _mm_lfence();
+    return res;
+#else
+    return get_utime();
 #endif
+}
 
-#if BENCH_FNV
-#define XXX_HASH_B hash_fnv_b
-#define XXX_HASH_S hash_fnv_s
+static inline uint64_t latency_timer_end(void)
+{
+#if HAVE_TSC
+    unsigned aux;
+    uint64_t res = __rdtscp(&aux);
+    _mm_lfence();
+    return res;
 #else
-#define XXX_HASH_B hash_jj_b
-#define XXX_HASH_S hash_jj_s
+    return get_utime();
 #endif
+}
 
-#define INTERNAL_WL (BENCH_WL + (BENCH_WL < 8 ? 1 : 0))
+// A log-linear histogram, as in HdrHistogram: values below 2^HIST_SUB_BITS are counted exactly, and every
+// power-of-2 range above is split into 2^(HIST_SUB_BITS - 1) equal buckets, so the relative error is at most
+// 1/64.
+enum { HIST_SUB_BITS = 7 };
+enum { HIST_SUB = 1 << HIST_SUB_BITS };
+enum { HIST_HALF = HIST_SUB / 2 };
+enum { HIST_SIZE = (64 - HIST_SUB_BITS + 2) * HIST_HALF };
 
 typedef struct {
-#if BENCH_B
+    uint64_t counts[HIST_SIZE];
+    uint64_t n;
+    uint64_t max;
+    double sum;
+} Histogram;
 
-# if INTERNAL_WL <= 256
-#  define MAX_WORD_LEN (INTERNAL_WL - 1)
-    char buf[INTERNAL_WL - 1];
-    uint8_t len;
+static inline size_t hist_index(uint64_t v)
+{
+    if (v < HIST_SUB) {
+        return v;
+    }
+    int shift = 63 - __builtin_clzll(v) - (HIST_SUB_BITS - 1);
+    return (size_t) shift * HIST_HALF + (v >> shift);
+}
 
-# elif INTERNAL_WL <= 65536
-#  define MAX_WORD_LEN (INTERNAL_WL - 2)
-    char buf[INTERNAL_WL - 2];
-    uint16_t len;
-# else
-#  error "Such a big BENCH_WL is not supported."
-# endif
+static inline void hist_add(Histogram *H, uint64_t v)
+{
+    ++H->counts[hist_index(v)];
+    ++H->n;
+    H->sum += v;
+    if (v > H->max) {
+        H->max = v;
+    }
+}
 
-#else
-# define MAX_WORD_LEN (INTERNAL_WL - 1)
-    char buf[INTERNAL_WL];
+// Returns the value at quantile 'q' (the middle of its bucket).
+static double hist_quantile(const Histogram *H, double q)
+{
+    uint64_t rank = (uint64_t) ceil(q * H->n);
+    if (!rank) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HIST_SIZE; ++i) {
+        seen += H->counts[i];
+        if (seen >= rank) {
+            if (i < HIST_SUB) {
+                return i;
+            }
+            size_t shift = i / HIST_HALF - 1;
+            uint64_t lo = (uint64_t) (i % HIST_HALF + HIST_HALF) << shift;
+            return lo + ((uint64_t) 1 << shift) / 2.0;
+        }
+    }
+    return H->max;
+}
+
+// Times 'nsamples' batches of 'batch' consecutive calls (going round the dictionary), and adds the times minus
+// 'overhead' (that of the timer itself) to the histogram. Like the RunFunc's, each of these calls its hash
+// function directly.
+typedef uint32_t (*LatencyFunc)(const Dict *D, size_t batch, size_t nsamples, uint64_t overhead, Histogram *H);
+
+#define DEFINE_LATENCY_LOOP(Call_) \
+    { \
+        const char *w = D->data; \
+        const char *w_end = w + D->size * D->stride; \
+        uint32_t res = 0; \
+        for (size_t i = 0; i < nsamples; ++i) { \
+            uint64_t t0 = latency_timer_start(); \
+            for (size_t j = 0; j < batch; ++j) { \
+                res ^= Call_; \
+                w += D->stride; \
+                if (w == w_end) { \
+                    w = D->data; \
+                } \
+            } \
+            uint64_t t = latency_timer_end() - t0; \
+            hist_add(H, t > overhead ? t - overhead : 0); \
+        } \
+        return res; \
+    }
+
+#define DEFINE_LATENCY_B(Name_, LenType_) \
+    static uint32_t latency_ ## Name_ ## _ ## LenType_( \
+            const Dict *D, size_t batch, size_t nsamples, uint64_t overhead, Histogram *H) \
+    { \
+        size_t len_off = D->stride - sizeof(LenType_); \
+        DEFINE_LATENCY_LOOP(hash_ ## Name_(w, record_len_ ## LenType_(w + len_off))) \
+    }
+
+#define DEFINE_LATENCY_S(Name_) \
+    static uint32_t latency_ ## Name_( \
+            const Dict *D, size_t batch, size_t nsamples, uint64_t overhead, Histogram *H) \
+    DEFINE_LATENCY_LOOP(hash_ ## Name_(w))
+
+DEFINE_LATENCY_B(fnv_b, uint8_t)
+DEFINE_LATENCY_B(fnv_b, uint16_t)
+DEFINE_LATENCY_B(jj_b, uint8_t)
+DEFINE_LATENCY_B(jj_b, uint16_t)
+DEFINE_LATENCY_B(jj_b_short, uint8_t)
+DEFINE_LATENCY_B(jj_b_short, uint16_t)
+DEFINE_LATENCY_S(fnv_s)
+DEFINE_LATENCY_S(jj_s)
+#if JJHASHV_HAVE_SSE2
+DEFINE_LATENCY_S(jj_s_sse2)
 #endif
-} Word;
 
 typedef struct {
-    Word *data;
-    size_t size;
-    size_t capacity;
-} Dict;
+    const char *name;
+    bool b;
+    // Maximum key length the function supports, or 0 if unlimited.
+    size_t max_len;
+    RunFunc run_u8;
+    RunFunc run_u16;
+    RunWsFunc run_ws_u8;
+    RunWsFunc run_ws_u16;
+    LatencyFunc latency_u8;
+    LatencyFunc latency_u16;
+} HashFunc;
+
+#define HASH_FUNC_B(Name_, MaxLen_) \
+    {#Name_, true, MaxLen_, run_ ## Name_ ## _uint8_t, run_ ## Name_ ## _uint16_t, \
+     run_ws_ ## Name_ ## _uint8_t, run_ws_ ## Name_ ## _uint16_t, \
+     latency_ ## Name_ ## _uint8_t, latency_ ## Name_ ## _uint16_t}
+
+#define HASH_FUNC_S(Name_) \
+    {#Name_, false, 0, run_ ## Name_, run_ ## Name_, run_ws_ ## Name_, run_ws_ ## Name_, \
+     latency_ ## Name_, latency_ ## Name_}
 
-static Dict dict_new(size_t capacity)
+static const HashFunc HASH_FUNCS[] = {
+    HASH_FUNC_B(fnv_b, 0),
+    HASH_FUNC_S(fnv_s),
+    HASH_FUNC_B(jj_b, 0),
+    HASH_FUNC_B(jj_b_short, JJHASH_SHORT_MAX),
+    HASH_FUNC_S(jj_s),
+#if JJHASHV_HAVE_SSE2
+    HASH_FUNC_S(jj_s_sse2),
+#endif
+};
+
+//-----------------------------------------------
+
+// Hardware performance counters (Linux only), counted for this thread in user space. Any of them may be
+// unavailable (e.g. with 'kernel.perf_event_paranoid' > 2, or in a virtual machine without a virtual PMU);
+// then its value is missing from the results.
+
+typedef enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    NCOUNTERS,
+} Counter;
+
+static const char *const COUNTER_NAMES[NCOUNTERS] = {
+    "cycles",
+    "instructions",
+    "branch_misses",
+    "l1d_misses",
+    "llc_misses",
+};
+
+typedef struct {
+    int fds[NCOUNTERS];
+} Perf;
+
+typedef struct {
+    bool valid[NCOUNTERS];
+    double values[NCOUNTERS];
+} PerfValues;
+
+static void perf_open(Perf *P, bool enabled)
 {
-    return (Dict) {
-        .data = malloc_or_die(capacity, sizeof(Word)),
-        .size = 0,
-        .capacity = capacity,
+    for (int i = 0; i < NCOUNTERS; ++i) {
+        P->fds[i] = -1;
+    }
+    if (!enabled) {
+        return;
+    }
+
+#if HAVE_PERF
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } EVENTS[NCOUNTERS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
     };
+
+    // The counters are not grouped, so that those that can be opened work even if the others cannot; if the
+    // kernel has to multiplex them, their values are scaled by the fraction of time they were running.
+    int nfailed = 0;
+    for (int i = 0; i < NCOUNTERS; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = EVENTS[i].type;
+        attr.config = EVENTS[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        P->fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (P->fds[i] < 0) {
+            fprintf(stderr, "perf: cannot count %s: %s.\n", COUNTER_NAMES[i], strerror(errno));
+            ++nfailed;
+        }
+    }
+    if (nfailed == NCOUNTERS) {
+        fprintf(stderr, "perf: no hardware counters available (see kernel.perf_event_paranoid); "
+                        "only timings will be reported.\n");
+    }
+#else
+    fprintf(stderr, "perf: hardware counters are only supported on Linux; only timings will be reported.\n");
+#endif
 }
 
-static void dict_add_raw(Dict *D, const Word *w)
+static inline void perf_start(const Perf *P)
 {
-    assert(D->size != D->capacity);
-    Word *dst = &D->data[D->size++];
-    memcpy(dst, w, sizeof(Word));
+#if HAVE_PERF
+    for (int i = 0; i < NCOUNTERS; ++i) {
+        if (P->fds[i] >= 0) {
+            ioctl(P->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(P->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void) P;
+#endif
 }
 
-static void dict_add(Dict *D, const char *s)
+// Stops and restarts counting without resetting the counters, to leave something out of the counts.
+static inline void perf_pause(const Perf *P)
 {
-    static Word w;
+#if HAVE_PERF
+    for (int i = 0; i < NCOUNTERS; ++i) {
+        if (P->fds[i] >= 0) {
+            ioctl(P->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#else
+    (void) P;
+#endif
+}
 
-    size_t ns = strlen(s);
+static inline void perf_resume(const Perf *P)
+{
+#if HAVE_PERF
+    for (int i = 0; i < NCOUNTERS; ++i) {
+        if (P->fds[i] >= 0) {
+            ioctl(P->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void) P;
+#endif
+}
 
-    assert(ns <= MAX_WORD_LEN);
+static inline void perf_stop(const Perf *P, PerfValues *V)
+{
+#if HAVE_PERF
+    for (int i = 0; i < NCOUNTERS; ++i) {
+        if (P->fds[i] >= 0) {
+            ioctl(P->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#endif
+    for (int i = 0; i < NCOUNTERS; ++i) {
+        V->valid[i] = false;
+#if HAVE_PERF
+        // value, time enabled, time running
+        uint64_t buf[3];
+        if (P->fds[i] >= 0 && read(P->fds[i], buf, sizeof(buf)) == (ssize_t) sizeof(buf) && buf[2]) {
+            V->valid[i] = true;
+            V->values[i] = buf[2] == buf[1] ? (double) buf[0] : (double) buf[0] * buf[1] / buf[2];
+        }
+#endif
+    }
+}
 
-    strncpy(w.buf, s, sizeof(w.buf));
+//-----------------------------------------------
 
-#if BENCH_B
-    w.len = ns;
+// Pins the calling thread to CPU 'cpu' (or to the one it is running on, if 'cpu' is negative).
+static void pin_to_cpu(int cpu)
+{
+#if defined(__linux__)
+    if (cpu < 0) {
+        cpu = sched_getcpu();
+    }
+    // CPU_SET() must not be given a negative CPU (sched_getcpu() failed).
+    bool ok = cpu >= 0;
+    if (ok) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        ok = sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Cannot pin to CPU %d: %s.\n", cpu, strerror(errno));
+        exit(1);
+    }
+#else
+    (void) cpu;
+    fprintf(stderr, "Pinning to a CPU is only supported on Linux; not pinning.\n");
 #endif
-
-    dict_add_raw(D, &w);
 }
 
-static uint32_t run_bench_once(Dict *D)
+static int current_cpu(void)
 {
-    Word *w = D->data;
-    Word *w_end = w + D->size;
-
-    uint32_t res = 0;
-    for (; w != w_end; ++w) {
-#if BENCH_B
-        res ^= XXX_HASH_B(w->buf, w->len);
+#if defined(__linux__)
+    return sched_getcpu();
 #else
-        res ^= XXX_HASH_S(w->buf);
+    return -1;
 #endif
+}
+
+// Number of times the thread was preempted so far (e.g. by a noisy neighbour).
+static long involuntary_context_switches(void)
+{
+#if defined(RUSAGE_THREAD)
+    struct rusage ru;
+    if (getrusage(RUSAGE_THREAD, &ru) == 0) {
+        return ru.ru_nivcsw;
     }
+#endif
+    return 0;
+}
 
-    return res;
+// A chain of dependent multiplications with a fixed number of them: its time only depends on the clock rate of
+// the core (and on preemptions), so comparing it before and after a data point tells if the frequency changed.
+static HASH_FUNC_ATTRS uint64_t calibration_chain(uint64_t n)
+{
+    uint64_t x = n;
+    for (uint64_t i = 0; i < n; ++i) {
+        x = x * UINT64_C(0x9E3779B97F4A7C15) + i;
+    }
+    return x;
 }
 
-#define BARRIER_NOTHING() \
-    asm volatile ("" ::: "memory")
+// Time of the calibration chain, the best of a few runs.
+static uint64_t calibrate(void)
+{
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 5; ++i) {
+        uint64_t t0 = get_utime();
+        BARRIER(calibration_chain(1 << 20));
+        uint64_t t = get_utime() - t0;
+        if (t < best) {
+            best = t;
+        }
+    }
+    return best;
+}
 
-#define BARRIER(X_) \
-    do { \
-        uint64_t x__ = (X_); \
-        asm volatile ("" : : "r"(x__) : "memory"); \
-    } while (0)
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
 
-static inline uint64_t get_utime(void)
+typedef struct {
+    double median;
+    // Median absolute deviation from the median.
+    double mad;
+    // Distribution-free 95% confidence interval of the median: order statistics with ranks
+    // 'n/2 -+ 1.96 sqrt(n)/2' (the extremes, for small 'n').
+    double ci_lo;
+    double ci_hi;
+} Stats;
+
+static double median_sorted(const uint64_t *xs, size_t n)
 {
+    return n % 2 ? (double) xs[n / 2] : (xs[n / 2 - 1] + (double) xs[n / 2]) / 2;
+}
+
+static Stats compute_stats(const uint64_t *samples, size_t n)
+{
+    uint64_t *xs = memdup_or_die(samples, n * sizeof(uint64_t));
+    qsort(xs, n, sizeof(uint64_t), compare_u64);
+
+    Stats st;
+    st.median = median_sorted(xs, n);
+
+    double half_width = 1.96 * sqrt((double) n) / 2;
+    long lo = (long) floor(n / 2.0 - half_width);
+    long hi = (long) ceil(1 + n / 2.0 + half_width);
+    st.ci_lo = xs[lo < 1 ? 0 : lo - 1];
+    st.ci_hi = xs[(size_t) hi > n ? n - 1 : (size_t) hi - 1];
+
+    // Deviations are computed in place, rounding the median down; this is exact for odd 'n'.
+    uint64_t m = st.median;
+    for (size_t i = 0; i < n; ++i) {
+        xs[i] = xs[i] > m ? xs[i] - m : m - xs[i];
+    }
+    qsort(xs, n, sizeof(uint64_t), compare_u64);
+    st.mad = median_sorted(xs, n);
+
+    free(xs);
+    return st;
+}
+
+//-----------------------------------------------
+
+typedef enum {
+    FORMAT_CSV,
+    FORMAT_JSON,
+} Format;
+
+typedef enum {
+    MODE_THROUGHPUT,
+    MODE_LATENCY,
+} Mode;
+
+typedef struct {
+    const HashFunc *funcs[array_size(HASH_FUNCS)];
+    size_t nfuncs;
+    size_t *wls;
+    size_t nwls;
+    size_t nw;
+    size_t nt;
+    uint64_t budget;
+    bool random_len;
+    const char *keys_path;
+    Format format;
+    bool perf;
+    bool pin;
+    int cpu;
+    uint64_t warmup_ns;
+    size_t min_reps;
+    size_t max_reps;
+    double target_ci;
+    uint64_t time_budget_ns;
+    Mode mode;
+    // Number of calls per timed batch in the latency mode, or 0 to choose it by the word length.
+    size_t batch;
+    // Size of the working set in bytes, or 0 to hash the dictionary itself.
+    size_t working_set;
+    Access access;
+    size_t prefetch;
+    // Flush the data from the caches before each pass.
+    bool flush;
+} Options;
+
+typedef struct {
+    const char *func;
+    size_t wl;
+    const Dict *D;
+    const WorkingSet *W;
+    size_t nt;
+    size_t reps;
+    Stats stats;
+    // The time stamp counter and the performance counters are those of the median repetition.
+    uint64_t tsc;
+    PerfValues perf;
+    long ctx_switches;
+    char flags[64];
+} Result;
+
+static size_t nresults_printed = 0;
+
+static void print_header(const Options *opts)
+{
+    if (opts->format == FORMAT_CSV && opts->mode == MODE_LATENCY) {
+        printf("func,wl,nw,avg_len,max_len,batch,samples,ns_per_tick,overhead_ticks,"
+               "mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,ctx_switches\n");
+    } else if (opts->format == FORMAT_CSV) {
+        printf("func,wl,nw,avg_len,max_len,nt,seconds,ns_per_hash,bytes_per_cycle,gb_per_s");
+        for (int i = 0; i < NCOUNTERS; ++i) {
+            printf(",%s", COUNTER_NAMES[i]);
+        }
+        printf(",ipc,cycles_per_byte,reps,seconds_mad,seconds_ci_lo,seconds_ci_hi,ctx_switches,flags,"
+               "working_set,access,flush\n");
+    } else {
+        printf("[");
+    }
+}
+
+static void print_footer(const Options *opts)
+{
+    if (opts->format == FORMAT_JSON) {
+        printf("%s]\n", nresults_printed ? "\n" : "");
+    }
+}
+
+// Formats a value that may be missing: as an empty field in CSV, and as null in JSON.
+static const char *format_maybe(char *buf, size_t nbuf, const Options *opts, bool valid, const char *fmt, double v)
+{
+    if (valid) {
+        snprintf(buf, nbuf, fmt, v);
+    } else {
+        snprintf(buf, nbuf, "%s", opts->format == FORMAT_JSON ? "null" : "");
+    }
+    return buf;
+}
+
+static void print_result(const Options *opts, const Result *r)
+{
+    double nhashes = (double) (r->W ? r->W->nslots : r->D->size) * r->nt;
+    double nbytes = (double) (r->W ? r->W->total_len : r->D->total_len) * r->nt;
+    size_t working_set = r->W ? r->W->nslots * r->W->slot_stride : r->D->size * r->D->stride;
+    const char *access = ACCESS_NAMES[r->W ? opts->access : ACCESS_SEQ];
+    double seconds = r->stats.median / 1e9;
+    double ns_per_hash = r->stats.median / nhashes;
+    double gb_per_s = nbytes / r->stats.median;
+    double avg_len = (double) r->D->total_len / r->D->size;
+
+    char bytes_per_cycle[32];
+    format_maybe(bytes_per_cycle, sizeof(bytes_per_cycle), opts, r->tsc, "%.5f", nbytes / r->tsc);
+
+    const bool *valid = r->perf.valid;
+    const double *values = r->perf.values;
+    char counters[NCOUNTERS][32];
+    for (int i = 0; i < NCOUNTERS; ++i) {
+        format_maybe(counters[i], sizeof(counters[i]), opts, valid[i], "%.0f", values[i]);
+    }
+    char ipc[32];
+    format_maybe(ipc, sizeof(ipc), opts,
+                 valid[COUNTER_CYCLES] && valid[COUNTER_INSTRUCTIONS] && values[COUNTER_CYCLES] > 0,
+                 "%.3f", values[COUNTER_INSTRUCTIONS] / values[COUNTER_CYCLES]);
+    char cycles_per_byte[32];
+    format_maybe(cycles_per_byte, sizeof(cycles_per_byte), opts, valid[COUNTER_CYCLES] && nbytes > 0,
+                 "%.5f", values[COUNTER_CYCLES] / nbytes);
+
+    if (opts->format == FORMAT_CSV) {
+        printf("%s,%zu,%zu,%.3f,%zu,%zu,%.5f,%.5f,%s,%.5f",
+               r->func, r->wl, r->D->size, avg_len, r->D->max_len, r->nt,
+               seconds, ns_per_hash, bytes_per_cycle, gb_per_s);
+        for (int i = 0; i < NCOUNTERS; ++i) {
+            printf(",%s", counters[i]);
+        }
+        printf(",%s,%s,%zu,%.5f,%.5f,%.5f,%ld,%s,%zu,%s,%d\n", ipc, cycles_per_byte,
+               r->reps, r->stats.mad / 1e9, r->stats.ci_lo / 1e9, r->stats.ci_hi / 1e9, r->ctx_switches, r->flags,
+               working_set, access, opts->flush);
+    } else {
+        printf("%s\n  {\"func\": \"%s\", \"wl\": %zu, \"nw\": %zu, \"avg_len\": %.3f, \"max_len\": %zu, \"nt\": %zu, "
+               "\"seconds\": %.5f, \"ns_per_hash\": %.5f, \"bytes_per_cycle\": %s, \"gb_per_s\": %.5f",
+               nresults_printed ? "," : "",
+               r->func, r->wl, r->D->size, avg_len, r->D->max_len, r->nt,
+               seconds, ns_per_hash, bytes_per_cycle, gb_per_s);
+        for (int i = 0; i < NCOUNTERS; ++i) {
+            printf(", \"%s\": %s", COUNTER_NAMES[i], counters[i]);
+        }
+        printf(", \"ipc\": %s, \"cycles_per_byte\": %s, \"reps\": %zu, \"seconds_mad\": %.5f, "
+               "\"seconds_ci_lo\": %.5f, \"seconds_ci_hi\": %.5f, \"ctx_switches\": %ld, \"flags\": \"%s\", "
+               "\"working_set\": %zu, \"access\": \"%s\", \"flush\": %s}",
+               ipc, cycles_per_byte,
+               r->reps, r->stats.mad / 1e9, r->stats.ci_lo / 1e9, r->stats.ci_hi / 1e9, r->ctx_switches, r->flags,
+               working_set, access, opts->flush ? "true" : "false");
+    }
+    fflush(stdout);
+    ++nresults_printed;
+}
+
+static size_t get_nt(const Options *opts, size_t wl, const Dict *D)
+{
+    size_t nt = opts->nt;
+    if (!nt) {
+        size_t l = opts->keys_path ? (D->total_len + D->size - 1) / D->size : wl;
+        nt = opts->budget / (l ? l : 1);
+        if (!nt) {
+            nt = 1;
+        }
+    }
+    return nt;
+}
+
+// Evicts 'n' bytes at 'p' from all the levels of the cache.
+static void flush_cache(const void *p, size_t n)
+{
+#if HAVE_TSC
+    for (size_t off = 0; off < n; off += 64) {
+        _mm_clflush((const char *) p + off);
+    }
+    _mm_clflush((const char *) p + n - 1);
+    _mm_mfence();
+#else
+    // No portable way to flush specific lines: overwrite a buffer twice as large as the last-level cache.
+    static char *evict;
+    static size_t nevict;
+    if (!evict) {
+        // _SC_LEVEL3_CACHE_SIZE is a glibc extension; elsewhere, assume 64 MiB.
+        long llc = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+        llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+        nevict = 2 * (llc > 0 ? (size_t) llc : (size_t) 64 << 20);
+        evict = malloc_or_die(nevict, 1);
+    }
+    for (size_t off = 0; off < nevict; off += 64) {
+        evict[off] = (char) off;
+    }
     BARRIER_NOTHING();
+    (void) p;
+    (void) n;
+#endif
+}
 
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    uint64_t res = ((uint64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+typedef struct {
+    RunFunc run;
+    RunWsFunc run_ws;
+    const Dict *D;
+    const WorkingSet *W;
+} Pass;
 
-    BARRIER(res);
-    return res;
+static inline uint32_t run_pass(const Pass *p)
+{
+    return p->W ? p->run_ws(p->W) : p->run(p->D);
 }
 
-int main()
+static void flush_pass(const Pass *p)
 {
-    gen_word_global_init();
+    if (p->W) {
+        flush_cache(p->W->base, p->W->nslots * p->W->slot_stride);
+        if (p->W->order) {
+            flush_cache(p->W->order, p->W->nslots * sizeof(uint32_t));
+        }
+    } else {
+        flush_cache(p->D->data, p->D->size * p->D->stride);
+    }
+}
 
-    Dict D = dict_new(BENCH_NW);
+static void run_func(const Options *opts, const Perf *P, const HashFunc *f, size_t wl, const Dict *D,
+                     const WorkingSet *W)
+{
+    // A pass over a working set is already long enough by itself.
+    size_t nt = W && !opts->nt ? 1 : get_nt(opts, wl, D);
 
-    for (int i = 0; i < BENCH_NW; ++i) {
-        static char buf[MAX_WORD_LEN + 1];
+    Pass pass = {
+        .run = dict_len_bytes(D) == 2 ? f->run_u16 : f->run_u8,
+        .run_ws = dict_len_bytes(D) == 2 ? f->run_ws_u16 : f->run_ws_u8,
+        .D = D,
+        .W = W,
+    };
 
-        size_t len = gen_word_len_almost_full(MAX_WORD_LEN);
-        gen_word(buf, len);
-        buf[len] = '\0';
+    uint64_t calibration_before = calibrate();
+    int cpu_before = current_cpu();
+
+    uint32_t summed_hashes = 0;
+    for (uint64_t t0 = get_utime(); get_utime() - t0 < opts->warmup_ns;) {
+        summed_hashes += run_pass(&pass);
+    }
+
+    uint64_t *samples = malloc_or_die(opts->max_reps, sizeof(uint64_t));
+    uint64_t *tscs = malloc_or_die(opts->max_reps, sizeof(uint64_t));
+    PerfValues *pvs = malloc_or_die(opts->max_reps, sizeof(PerfValues));
+
+    // Repeat until the confidence interval is narrow enough, or we are out of repetitions or time.
+    size_t reps = 0;
+    Stats st;
+    bool converged = false;
+    // Only the preemptions of the timed repetitions count, not those of the calibration and warmup.
+    long ctx_switches_before = involuntary_context_switches();
+    uint64_t start = get_utime();
+    while (reps < opts->max_reps) {
+        uint64_t t = 0;
+        uint64_t c = 0;
+        perf_start(P);
+        if (!opts->flush) {
+            uint64_t t0 = get_utime();
+            uint64_t c0 = get_tsc();
+
+            //--------------------
+
+            for (size_t i = 0; i < nt; ++i) {
+                summed_hashes += run_pass(&pass);
+            }
+
+            //--------------------
+
+            c = get_tsc() - c0;
+            t = get_utime() - t0;
+        } else {
+            // Each pass is timed (and counted) separately, leaving the flushes out.
+            for (size_t i = 0; i < nt; ++i) {
+                perf_pause(P);
+                flush_pass(&pass);
+                perf_resume(P);
 
-        dict_add(&D, buf);
+                uint64_t t0 = get_utime();
+                uint64_t c0 = get_tsc();
+                summed_hashes += run_pass(&pass);
+                c += get_tsc() - c0;
+                t += get_utime() - t0;
+            }
+        }
+        perf_stop(P, &pvs[reps]);
+
+        samples[reps] = t;
+        tscs[reps] = c;
+        ++reps;
+
+        if (reps >= opts->min_reps) {
+            st = compute_stats(samples, reps);
+            converged = (st.ci_hi - st.ci_lo) / 2 <= opts->target_ci * st.median;
+            if (converged || get_utime() - start >= opts->time_budget_ns) {
+                break;
+            }
+        }
+    }
+    if (reps < opts->min_reps) {
+        st = compute_stats(samples, reps);
+    }
+
+    BARRIER(summed_hashes);
+
+    long ctx_switches = involuntary_context_switches() - ctx_switches_before;
+    int cpu_after = current_cpu();
+    uint64_t calibration_after = calibrate();
+
+    // The repetition closest to the median.
+    size_t median_rep = 0;
+    for (size_t i = 1; i < reps; ++i) {
+        if (fabs(samples[i] - st.median) < fabs(samples[median_rep] - st.median)) {
+            median_rep = i;
+        }
+    }
+
+    Result r = {
+        .func = f->name,
+        .wl = wl,
+        .D = D,
+        .W = W,
+        .nt = nt,
+        .reps = reps,
+        .stats = st,
+        .tsc = tscs[median_rep],
+        .perf = pvs[median_rep],
+        .ctx_switches = ctx_switches,
+        .flags = "",
+    };
+
+    // Flags for results that should not be trusted: the confidence interval did not narrow down to the target
+    // ('unconverged'); the thread was preempted more than once per repetition or the spread is large ('noisy'); the
+    // clock rate changed, as seen by the calibration chain or by the core cycles per nanosecond of the repetitions
+    // ('freq'); the thread moved to another CPU ('migrated').
+    bool noisy = (size_t) ctx_switches > reps || st.mad > 0.05 * st.median;
+    double calibration_ratio = (double) calibration_after / calibration_before;
+    bool freq = calibration_ratio > 1.05 || calibration_ratio < 1 / 1.05;
+    if (pvs[0].valid[COUNTER_CYCLES]) {
+        double rate_min = INFINITY;
+        double rate_max = 0;
+        for (size_t i = 0; i < reps; ++i) {
+            double rate = pvs[i].values[COUNTER_CYCLES] / samples[i];
+            rate_min = rate < rate_min ? rate : rate_min;
+            rate_max = rate > rate_max ? rate : rate_max;
+        }
+        freq = freq || rate_max > 1.05 * rate_min;
+    }
+    bool migrated = cpu_before != cpu_after;
+
+    const char *names[] = {"unconverged", "noisy", "freq", "migrated"};
+    bool set[] = {!converged && opts->max_reps > 1, noisy, freq, migrated};
+    for (size_t i = 0; i < array_size(names); ++i) {
+        if (set[i]) {
+            size_t len = strlen(r.flags);
+            snprintf(r.flags + len, sizeof(r.flags) - len, "%s%s", len ? "|" : "", names[i]);
+        }
+    }
+    if (r.flags[0]) {
+        fprintf(stderr, "%s, wl=%zu: %s.\n", f->name, wl, r.flags);
     }
 
-    assert(D.size == D.capacity);
+    free(samples);
+    free(tscs);
+    free(pvs);
+
+    print_result(opts, &r);
+}
 
+// Nanoseconds per tick of the latency timer.
+static double latency_ns_per_tick(void)
+{
+#if HAVE_TSC
     uint64_t t0 = get_utime();
+    uint64_t c0 = latency_timer_start();
+    while (get_utime() - t0 < 50000000) {
+    }
+    uint64_t c = latency_timer_end() - c0;
+    uint64_t t = get_utime() - t0;
+    return (double) t / c;
+#else
+    return 1;
+#endif
+}
+
+// The median time of an empty batch.
+static uint64_t latency_overhead(void)
+{
+    enum { N = 100001 };
+    static uint64_t samples[N];
+    for (size_t i = 0; i < N; ++i) {
+        uint64_t t0 = latency_timer_start();
+        samples[i] = latency_timer_end() - t0;
+    }
+    qsort(samples, N, sizeof(uint64_t), compare_u64);
+    return samples[N / 2];
+}
+
+// The latency mode: instead of the total time of all the passes, the distribution of the times of batches of
+// calls (as many of them as there are calls in the passes, divided by the batch size). The first batches are
+// timed with cold caches and branch predictors unless there is a warmup.
+static void run_latency(const Options *opts, double ns_per_tick, uint64_t overhead,
+                        const HashFunc *f, size_t wl, const Dict *D)
+{
+    size_t nt = get_nt(opts, wl, D);
+
+    // Batches of about 256 bytes: a single call for long keys; for short ones, enough calls that the timer's own
+    // jitter does not swamp them.
+    size_t batch = opts->batch;
+    if (!batch) {
+        size_t l = (D->total_len + D->size - 1) / D->size;
+        batch = l >= 256 ? 1 : 256 / (l ? l : 1);
+    }
+    uint64_t nsamples = (uint64_t) nt * D->size / batch;
+    if (!nsamples) {
+        nsamples = 1;
+    }
 
-    //--------------------
+    LatencyFunc latency = dict_len_bytes(D) == 2 ? f->latency_u16 : f->latency_u8;
+    RunFunc run = dict_len_bytes(D) == 2 ? f->run_u16 : f->run_u8;
 
     uint32_t summed_hashes = 0;
-    for (int i = 0; i < BENCH_NT; ++i) {
-        summed_hashes += run_bench_once(&D);
+    for (uint64_t t0 = get_utime(); get_utime() - t0 < opts->warmup_ns;) {
+        summed_hashes += run(D);
     }
 
-    //--------------------
+    Histogram *H = calloc_or_die(1, sizeof(Histogram));
+    long ctx_switches_before = involuntary_context_switches();
+    summed_hashes += latency(D, batch, nsamples, overhead, H);
+    BARRIER(summed_hashes);
 
-    uint64_t t = get_utime() - t0;
+    long ctx_switches = involuntary_context_switches() - ctx_switches_before;
+
+    // Per call, in nanoseconds.
+    double scale = ns_per_tick / batch;
+    double avg_len = (double) D->total_len / D->size;
+    double mean = H->sum / H->n * scale;
+    double p50 = hist_quantile(H, 0.5) * scale;
+    double p90 = hist_quantile(H, 0.9) * scale;
+    double p99 = hist_quantile(H, 0.99) * scale;
+    double p999 = hist_quantile(H, 0.999) * scale;
+    double max = H->max * scale;
+
+    if (opts->format == FORMAT_CSV) {
+        printf("%s,%zu,%zu,%.3f,%zu,%zu,%" PRIu64 ",%.5f,%" PRIu64 ",%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%ld\n",
+               f->name, wl, D->size, avg_len, D->max_len, batch, H->n, ns_per_tick, overhead,
+               mean, p50, p90, p99, p999, max, ctx_switches);
+    } else {
+        printf("%s\n  {\"func\": \"%s\", \"wl\": %zu, \"nw\": %zu, \"avg_len\": %.3f, \"max_len\": %zu, "
+               "\"batch\": %zu, \"samples\": %" PRIu64 ", \"ns_per_tick\": %.5f, \"overhead_ticks\": %" PRIu64 ", "
+               "\"mean_ns\": %.3f, \"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, \"p999_ns\": %.3f, "
+               "\"max_ns\": %.3f, \"ctx_switches\": %ld}",
+               nresults_printed ? "," : "",
+               f->name, wl, D->size, avg_len, D->max_len, batch, H->n, ns_per_tick, overhead,
+               mean, p50, p90, p99, p999, max, ctx_switches);
+    }
+    fflush(stdout);
+    ++nresults_printed;
+
+    free(H);
+}
+
+static WorkingSet gen_working_set(const Options *opts, const Dict *D)
+{
+    WorkingSet W;
+    W.slot_stride = 8 + D->stride;
+    W.nslots = opts->working_set / W.slot_stride;
+    if (W.nslots < D->size) {
+        W.nslots = D->size;
+    }
+    if (W.nslots > UINT32_MAX) {
+        fprintf(stderr, "Working set is too large.\n");
+        exit(1);
+    }
+    W.base = malloc_or_die(W.nslots, W.slot_stride);
+    W.total_len = 0;
+    W.prefetch = opts->prefetch;
+
+    // Slot 'i' holds word 'i % nw'.
+    for (size_t i = 0; i < W.nslots; ++i) {
+        size_t k = i % D->size;
+        memcpy(W.base + i * W.slot_stride + 8, D->data + k * D->stride, D->stride);
+        W.total_len += dict_word_len(D, k);
+    }
+
+    uint32_t *perm = malloc_or_die(W.nslots, sizeof(uint32_t));
+    for (size_t i = 0; i < W.nslots; ++i) {
+        perm[i] = i;
+    }
+    PRNG prng;
+    prng_init(&prng, 2);
+    if (opts->access == ACCESS_RANDOM) {
+        // Fisher-Yates
+        for (size_t i = W.nslots - 1; i > 0; --i) {
+            size_t j = prng_next_limit(&prng, i + 1);
+            uint32_t tmp = perm[i];
+            perm[i] = perm[j];
+            perm[j] = tmp;
+        }
+    } else if (opts->access == ACCESS_CHASE) {
+        // Sattolo: a random permutation that is a single cycle.
+        for (size_t i = W.nslots - 1; i > 0; --i) {
+            size_t j = prng_next_limit(&prng, i);
+            uint32_t tmp = perm[i];
+            perm[i] = perm[j];
+            perm[j] = tmp;
+        }
+    }
+
+    if (opts->access == ACCESS_CHASE) {
+        for (size_t i = 0; i < W.nslots; ++i) {
+            uint64_t next = (uint64_t) perm[i] * W.slot_stride;
+            memcpy(W.base + i * W.slot_stride, &next, sizeof(next));
+        }
+        free(perm);
+        W.order = NULL;
+        W.start = 0;
+    } else {
+        for (size_t i = 0; i < W.nslots; ++i) {
+            uint64_t next = (uint64_t) ((i + 1) % W.nslots) * W.slot_stride;
+            memcpy(W.base + i * W.slot_stride, &next, sizeof(next));
+        }
+        W.order = perm;
+        W.start = 0;
+    }
+    return W;
+}
+
+static void working_set_free(WorkingSet *W)
+{
+    free(W->base);
+    free(W->order);
+}
+
+// Generates 'nw' words for word length 'wl' (as BENCH_WL of the compile-time version): the maximum length of a
+// word is 'wl - 1' ('wl' for 'wl < 8'), minus one more byte for pointer-and-length strings with 'wl > 256'.
+static Dict gen_dict(const Options *opts, size_t wl, bool b)
+{
+    size_t stride = wl + (wl < 8 ? 1 : 0);
+    size_t max_len = stride - (b && stride > 256 ? 2 : 1);
+
+    // Every word length starts from the same seed, so all the functions see the same words for the same length,
+    // whatever the other lengths in the sweep.
+    gen_word_global_init();
+
+    Dict D = dict_new(opts->nw, stride, b);
+    char *buf = malloc_or_die(max_len + 1, 1);
+    for (size_t i = 0; i < opts->nw; ++i) {
+        size_t len = opts->random_len
+            ? gen_word_len_uniform(max_len)
+            : gen_word_len_almost_full(max_len);
+        gen_word(buf, len);
+        dict_add(&D, buf, len);
+    }
+    free(buf);
+    return D;
+}
+
+// Reads the words from a file, one per line.
+static Dict read_dict(const char *path, bool b)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+
+    char *line = NULL;
+    size_t line_capacity = 0;
+    size_t nwords = 0;
+    size_t max_len = 0;
+    ssize_t n;
+    while ((n = getline(&line, &line_capacity, f)) >= 0) {
+        if (n && line[n - 1] == '\n') {
+            --n;
+        }
+        if ((size_t) n > max_len) {
+            max_len = n;
+        }
+        ++nwords;
+    }
+    if (!nwords) {
+        fprintf(stderr, "%s: no words.\n", path);
+        exit(1);
+    }
+
+    size_t stride = max_len + 1;
+    if (b && stride > 256) {
+        ++stride;
+    }
+    if (stride > 65536) {
+        fprintf(stderr, "%s: words of more than 65534 bytes are not supported.\n", path);
+        exit(1);
+    }
+
+    rewind(f);
+    Dict D = dict_new(nwords, stride, b);
+    while ((n = getline(&line, &line_capacity, f)) >= 0) {
+        if (n && line[n - 1] == '\n') {
+            --n;
+        }
+        if (!b && memchr(line, '\0', n)) {
+            fprintf(stderr, "%s: a word contains a null byte.\n", path);
+            exit(1);
+        }
+        dict_add(&D, line, n);
+    }
+    free(line);
+    fclose(f);
+    return D;
+}
 
-    printf("%.5f\n", ((double) t) / 1e9);
+static void run_all(const Options *opts)
+{
+    bool need[2] = {false, false};
+    for (size_t k = 0; k < opts->nfuncs; ++k) {
+        need[opts->funcs[k]->b] = true;
+    }
+
+    if (opts->pin) {
+        pin_to_cpu(opts->cpu);
+    }
+
+    Perf P;
+    perf_open(&P, opts->perf && opts->mode == MODE_THROUGHPUT);
+
+    double ns_per_tick = 0;
+    uint64_t overhead = 0;
+    if (opts->mode == MODE_LATENCY) {
+        ns_per_tick = latency_ns_per_tick();
+        overhead = latency_overhead();
+    }
+
+    print_header(opts);
+
+    size_t nwls = opts->keys_path ? 1 : opts->nwls;
+    for (size_t i = 0; i < nwls; ++i) {
+        Dict dicts[2];
+        WorkingSet wss[2];
+        for (int b = 0; b < 2; ++b) {
+            if (need[b]) {
+                dicts[b] = opts->keys_path ? read_dict(opts->keys_path, b) : gen_dict(opts, opts->wls[i], b);
+                if (opts->working_set) {
+                    wss[b] = gen_working_set(opts, &dicts[b]);
+                }
+            }
+        }
+        for (size_t k = 0; k < opts->nfuncs; ++k) {
+            const Dict *D = &dicts[opts->funcs[k]->b];
+            size_t wl = opts->keys_path ? D->stride : opts->wls[i];
+            const HashFunc *f = opts->funcs[k];
+            if (f->max_len && D->max_len > f->max_len) {
+                fprintf(stderr, "Skipping %s for wl=%zu: words are longer than %zu bytes.\n", f->name, wl, f->max_len);
+            } else if (opts->mode == MODE_LATENCY) {
+                run_latency(opts, ns_per_tick, overhead, f, wl, D);
+            } else {
+                run_func(opts, &P, f, wl, D, opts->working_set ? &wss[f->b] : NULL);
+            }
+        }
+        for (int b = 0; b < 2; ++b) {
+            if (need[b]) {
+                dict_free(&dicts[b]);
+                if (opts->working_set) {
+                    working_set_free(&wss[b]);
+                }
+            }
+        }
+    }
+
+    print_footer(opts);
+}
+
+//-----------------------------------------------
+
+static __attribute__((noreturn)) void usage(void)
+{
+    fprintf(stderr, "USAGE: bench [-h] [-f FUNC,...] [-L WL,...] [-n NW] [-t NT | -T BUDGET] [-r] [-k FILE] [-o csv|json] [-p]\n"
+                    "             [-c CPU|auto] [-w MS] [-R MIN[,MAX]] [-e REL] [-B SECONDS] [-m throughput|latency] [-b N]\n"
+                    "             [-W MIB] [-a seq|random|chase] [-P N] [-F]\n");
+    fprintf(stderr, "  -f FUNC,...   hash functions:");
+    for (size_t k = 0; k < array_size(HASH_FUNCS); ++k) {
+        fprintf(stderr, " %s", HASH_FUNCS[k].name);
+    }
+    fprintf(stderr, " (default: fnv_b,jj_b)\n");
+    fprintf(stderr, "  -L WL,...     word lengths to sweep (default: 16)\n");
+    fprintf(stderr, "  -n NW         number of words (default: 200)\n");
+    fprintf(stderr, "  -t NT         number of passes over the words\n");
+    fprintf(stderr, "  -T BUDGET     number of passes is BUDGET / WL (default: 15000000)\n");
+    fprintf(stderr, "  -r            uniformly random word lengths from 0 to the maximum\n");
+    fprintf(stderr, "  -k FILE       read the words from FILE, one per line, instead of generating them\n");
+    fprintf(stderr, "  -o FORMAT     output format (default: csv)\n");
+    fprintf(stderr, "  -p            count cycles, instructions, branch and cache misses (Linux perf events)\n");
+    fprintf(stderr, "  -c CPU|auto   pin to CPU (auto: the one we started on)\n");
+    fprintf(stderr, "  -w MS         warm up for MS milliseconds before each data point (default: 0)\n");
+    fprintf(stderr, "  -R MIN[,MAX]  number of repetitions of each data point (default: 1)\n");
+    fprintf(stderr, "  -e REL        stop repeating once the 95%% CI of the median is within REL of it (default: 0.01)\n");
+    fprintf(stderr, "  -B SECONDS    stop repeating after SECONDS, if done MIN repetitions (default: 10)\n");
+    fprintf(stderr, "  -m MODE       throughput (default), or latency: percentiles of the time per call\n");
+    fprintf(stderr, "  -b N          calls per timed batch in the latency mode (default: about 256 bytes' worth)\n");
+    fprintf(stderr, "  -W MIB        copy the words over a working set of MIB MiB and hash them all in each pass\n");
+    fprintf(stderr, "  -a ACCESS     order of the keys in the working set: seq (default), random, or chase (each\n"
+                    "                key's address is stored with the previous key)\n");
+    fprintf(stderr, "  -P N          prefetch the key N keys ahead (seq and random access only)\n");
+    fprintf(stderr, "  -F            flush the words (or the working set) from the caches before each pass\n");
+    exit(2);
+}
+
+static size_t parse_size(const char *s)
+{
+    char *end;
+    errno = 0;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (errno || end == s || *end || s[0] == '-') {
+        fprintf(stderr, "Invalid number: '%s'.\n", s);
+        usage();
+    }
+    return v;
+}
+
+static double parse_double(const char *s)
+{
+    char *end;
+    errno = 0;
+    double v = strtod(s, &end);
+    if (errno || end == s || *end || !(v >= 0)) {
+        fprintf(stderr, "Invalid number: '%s'.\n", s);
+        usage();
+    }
+    return v;
+}
+
+static void parse_funcs(Options *opts, char *arg)
+{
+    opts->nfuncs = 0;
+    for (char *name = strtok(arg, ","); name; name = strtok(NULL, ",")) {
+        size_t k = 0;
+        while (k < array_size(HASH_FUNCS) && strcmp(HASH_FUNCS[k].name, name) != 0) {
+            ++k;
+        }
+        if (k == array_size(HASH_FUNCS)) {
+            fprintf(stderr, "Unknown hash function '%s'.\n", name);
+            usage();
+        }
+        if (opts->nfuncs == array_size(opts->funcs)) {
+            usage();
+        }
+        opts->funcs[opts->nfuncs++] = &HASH_FUNCS[k];
+    }
+    if (!opts->nfuncs) {
+        usage();
+    }
+}
+
+static void parse_wls(Options *opts, char *arg)
+{
+    size_t capacity = 0;
+    opts->wls = NULL;
+    opts->nwls = 0;
+    for (char *s = strtok(arg, ","); s; s = strtok(NULL, ",")) {
+        size_t wl = parse_size(s);
+        if (wl < 1 || wl > 65536) {
+            fprintf(stderr, "Word length must be from 1 to 65536.\n");
+            usage();
+        }
+        if (opts->nwls == capacity) {
+            opts->wls = x2realloc_or_die(opts->wls, &capacity, sizeof(size_t));
+        }
+        opts->wls[opts->nwls++] = wl;
+    }
+    if (!opts->nwls) {
+        usage();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static size_t default_wls[] = {16};
+    static char default_funcs[] = "fnv_b,jj_b";
+
+    Options opts = {
+        .wls = default_wls,
+        .nwls = array_size(default_wls),
+        .nw = 200,
+        .nt = 0,
+        .budget = 15000000,
+        .random_len = false,
+        .keys_path = NULL,
+        .format = FORMAT_CSV,
+        .perf = false,
+        .pin = false,
+        .cpu = -1,
+        .warmup_ns = 0,
+        .min_reps = 1,
+        .max_reps = 1,
+        .target_ci = 0.01,
+        .time_budget_ns = 10000000000,
+        .mode = MODE_THROUGHPUT,
+        .batch = 0,
+        .working_set = 0,
+        .access = ACCESS_SEQ,
+        .prefetch = 0,
+        .flush = false,
+    };
+    parse_funcs(&opts, default_funcs);
+    // Whether -R, -e or -B was given, which the latency mode does not support.
+    bool reps_given = false;
+
+    for (int c; (c = getopt(argc, argv, "hf:L:n:t:T:rk:o:pc:w:R:e:B:m:b:W:a:P:F")) != -1;) {
+        switch (c) {
+        case 'f':
+            parse_funcs(&opts, optarg);
+            break;
+        case 'L':
+            parse_wls(&opts, optarg);
+            break;
+        case 'n':
+            opts.nw = parse_size(optarg);
+            if (!opts.nw) {
+                usage();
+            }
+            break;
+        case 't':
+            opts.nt = parse_size(optarg);
+            break;
+        case 'T':
+            opts.budget = parse_size(optarg);
+            break;
+        case 'r':
+            opts.random_len = true;
+            break;
+        case 'k':
+            opts.keys_path = optarg;
+            break;
+        case 'p':
+            opts.perf = true;
+            break;
+        case 'c':
+            opts.pin = true;
+            opts.cpu = strcmp(optarg, "auto") == 0 ? -1 : (int) parse_size(optarg);
+            break;
+        case 'w':
+            opts.warmup_ns = parse_size(optarg) * 1000000;
+            break;
+        case 'R': {
+            char *comma = strchr(optarg, ',');
+            if (comma) {
+                *comma = '\0';
+            }
+            opts.min_reps = parse_size(optarg);
+            opts.max_reps = comma ? parse_size(comma + 1) : opts.min_reps;
+            if (!opts.min_reps || opts.max_reps < opts.min_reps) {
+                usage();
+            }
+            reps_given = true;
+            break;
+        }
+        case 'e':
+            opts.target_ci = parse_double(optarg);
+            reps_given = true;
+            break;
+        case 'B':
+            opts.time_budget_ns = parse_double(optarg) * 1e9;
+            reps_given = true;
+            break;
+        case 'm':
+            if (strcmp(optarg, "throughput") == 0) {
+                opts.mode = MODE_THROUGHPUT;
+            } else if (strcmp(optarg, "latency") == 0) {
+                opts.mode = MODE_LATENCY;
+            } else {
+                usage();
+            }
+            break;
+        case 'b':
+            opts.batch = parse_size(optarg);
+            break;
+        case 'W':
+            opts.working_set = parse_size(optarg) << 20;
+            break;
+        case 'a': {
+            size_t k = 0;
+            while (k < array_size(ACCESS_NAMES) && strcmp(ACCESS_NAMES[k], optarg) != 0) {
+                ++k;
+            }
+            if (k == array_size(ACCESS_NAMES)) {
+                usage();
+            }
+            opts.access = k;
+            break;
+        }
+        case 'P':
+            opts.prefetch = parse_size(optarg);
+            break;
+        case 'F':
+            opts.flush = true;
+            break;
+        case 'o':
+            if (strcmp(optarg, "csv") == 0) {
+                opts.format = FORMAT_CSV;
+            } else if (strcmp(optarg, "json") == 0) {
+                opts.format = FORMAT_JSON;
+            } else {
+                usage();
+            }
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind != argc) {
+        usage();
+    }
+    if (opts.mode == MODE_LATENCY && (opts.working_set || opts.flush)) {
+        fprintf(stderr, "-W and -F are only supported in the throughput mode.\n");
+        usage();
+    }
+    if (opts.mode == MODE_LATENCY && opts.perf) {
+        fprintf(stderr, "-p is only supported in the throughput mode.\n");
+        usage();
+    }
+    if (opts.mode == MODE_LATENCY && reps_given) {
+        fprintf(stderr, "-R, -e and -B are only supported in the throughput mode.\n");
+        usage();
+    }
+    if (opts.access != ACCESS_SEQ && !opts.working_set) {
+        fprintf(stderr, "-a requires -W.\n");
+        usage();
+    }
+    if (opts.access == ACCESS_CHASE && opts.prefetch) {
+        fprintf(stderr, "-P is not supported with -a chase.\n");
+        usage();
+    }
 
-    fprintf(stderr, "summed_hashes=%" PRIu32 "\n", summed_hashes);
+    run_all(&opts);
 }
@@ -7,47 +7,35 @@ awk_single_expr() {
     awk "$@" "BEGIN { $expr; exit }"
 }
 
-do_bench() {
-    local id=$1; shift
-
-    local -a flags=( -O3 -Wall -Wextra -march=native )
-    local -a files=( bench.c ../utils/{common,gen_word}.c )
-    ${CC:-gcc} -DBENCH_FNV=1 "${flags[@]}" "${files[@]}" "$@" -o bench_fnv || return $?
-    ${CC:-gcc} -DBENCH_FNV=0 "${flags[@]}" "${files[@]}" "$@" -o bench_jj || return $?
-
-    local t_fnv
-    t_fnv=$($PREFIX ./bench_fnv 2>/dev/null) || return $?
-
-    local t_jj
-    t_jj=$($PREFIX ./bench_jj 2>/dev/null) || return $?
-
-    local ratio
-    ratio=$(awk_single_expr 'printf("%.5f\n", a / b)' -v"a=$t_fnv" -v"b=$t_jj") || return $?
-
-    echo -e "$id\t$ratio\t\t$t_fnv\t$t_jj"
-}
-
 what=${1?}; shift
 
-if [[ $what == s ]]; then
-    BENCH_B=0
-elif [[ $what == b ]]; then
-    BENCH_B=1
-else
+if [[ $what != [sb] ]]; then
     echo >&2 "Unknown first argument '$what' (must be either 's' or 'b')."
     exit 1
 fi
 
-bench_for_n() {
-    local i=$1; shift
-    local n=$1; shift
-    do_bench "$i $n" -DBENCH_WL=$n -DBENCH_B=$BENCH_B -DBENCH_NW=200 -DBENCH_NT=$(( 15000000 / n )) "$@"
-}
+${CC:-gcc} -O3 -Wall -Wextra -march=native bench.c ../utils/{common,gen_word}.c -lm "$@" -o bench
 
+ids=()
+wls=()
 for (( i = 3; i <= 23; ++i )); do
     j=$(awk_single_expr 'print(int(1.6 ^ i))' -v"i=$i")
     if (( j % 4 )); then
         (( j = j - (j % 4) + 4 ))
     fi
-    bench_for_n "$i" "$j" "$@"
+    ids+=( "$i" )
+    wls+=( "$j" )
 done
+
+# The whole sweep runs in one process, pinned to the CPU it started on; each data point is warmed up, then
+# repeated (1500000 / length passes at a time) until the 95% confidence interval of the median time is within
+# 1% of it, or for 3 seconds. Data points that should not be trusted are reported on stderr.
+# Then the CSV is turned into the format of RESULTS_{b,s}.txt: id, length, ratio (FNV time / jjhash time), and
+# the median times of 10 repetitions, to keep the scale of the old single runs of 15000000 / length passes.
+$PREFIX ./bench -f fnv_$what,jj_$what -n 200 -T 1500000 -c auto -w 100 -R 5,100 -e 0.01 -B 3 \
+        -L "$(IFS=,; echo "${wls[*]}")" -o csv |
+    awk -F, -v"ids=${ids[*]}" '
+        BEGIN { split(ids, id, " ") }
+        NR == 1 { next }
+        $1 ~ /^fnv/ { t_fnv = 10 * $7; next }
+        { printf("%s %s\t%.5f\t\t%.5f\t%.5f\n", id[++k], $2, t_fnv / (10 * $7), t_fnv, 10 * $7) }'
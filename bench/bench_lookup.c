@@ -0,0 +1,258 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+// Compares hash table lookups that hash each key and probe its bucket right away with ones that hash a batch of
+// keys with jjhashl64_b_prefetch (prefetching the buckets) and probe the buckets afterwards. The table is much
+// larger than the last-level cache (1 GiB by default), so nearly every probe misses.
+
+#include "../utils/common.h"
+#include "../utils/gen_word.h"
+#include "../utils/prng.h"
+
+#include "../jjhash_64/jjhash64.h"
+#include "../jjhash_64/jjhashl64.h"
+
+#define HASH_FUNC_ATTRS __attribute__((unused, noinline))
+
+// Base 2 logarithm of the number of buckets; a bucket is 64 bytes.
+#ifndef BENCH_LOG2_NBUCKETS
+#define BENCH_LOG2_NBUCKETS 24
+#endif
+
+// Number of keys in the table (there are two slots per bucket).
+#ifndef BENCH_NK
+#define BENCH_NK (1 << BENCH_LOG2_NBUCKETS)
+#endif
+
+// Number of lookups (all of them are hits).
+#ifndef BENCH_NQ
+#define BENCH_NQ (1 << 22)
+#endif
+
+// Number of times to do all the lookups.
+#ifndef BENCH_NT
+#define BENCH_NT 3
+#endif
+
+// Number of keys hashed (and prefetched) at once.
+#ifndef BENCH_BATCH
+#define BENCH_BATCH 32
+#endif
+
+// Maximum key length; lengths are uniformly random from 4 to this.
+#ifndef BENCH_KL
+#define BENCH_KL 20
+#endif
+
+enum { MAX_KEY_LEN = 23 };
+
+_Static_assert(BENCH_KL >= 4 && BENCH_KL <= MAX_KEY_LEN, "BENCH_KL must be from 4 to 23");
+
+typedef struct {
+    uint64_t hash;
+    uint8_t len; // 0 if the slot is empty.
+    char key[MAX_KEY_LEN];
+} Slot;
+
+typedef struct {
+    Slot slots[2];
+} Bucket;
+
+_Static_assert(sizeof(Bucket) == 64, "a bucket must be one cache line");
+
+typedef struct {
+    Bucket *buckets;
+    size_t mask;
+} Table;
+
+typedef struct {
+    const char **ss;
+    size_t *nss;
+    size_t n;
+} Queries;
+
+static void table_insert(Table *T, const char *s, size_t ns, uint64_t h)
+{
+    for (size_t b = h & T->mask;; b = (b + 1) & T->mask) {
+        for (int i = 0; i < 2; ++i) {
+            Slot *slot = &T->buckets[b].slots[i];
+            if (!slot->len) {
+                slot->hash = h;
+                slot->len = ns;
+                memcpy(slot->key, s, ns);
+                return;
+            }
+        }
+    }
+}
+
+// Returns the index of the bucket the key was found in, or SIZE_MAX.
+static inline size_t table_find(const Table *T, const Bucket *bucket, const char *s, size_t ns, uint64_t h)
+{
+    size_t b = bucket - T->buckets;
+    for (;; b = (b + 1) & T->mask) {
+        for (int i = 0; i < 2; ++i) {
+            const Slot *slot = &T->buckets[b].slots[i];
+            if (!slot->len) {
+                return SIZE_MAX;
+            }
+            if (slot->hash == h && slot->len == ns && memcmp(slot->key, s, ns) == 0) {
+                return b;
+            }
+        }
+    }
+}
+
+static void gen_table(Table *T, Queries *Q)
+{
+    size_t nbuckets = (size_t) 1 << BENCH_LOG2_NBUCKETS;
+    T->buckets = aligned_alloc(sizeof(Bucket), nbuckets * sizeof(Bucket));
+    if (!T->buckets) {
+        die_out_of_memory();
+    }
+    memset(T->buckets, 0, nbuckets * sizeof(Bucket));
+    T->mask = nbuckets - 1;
+
+    Q->ss = malloc_or_die(BENCH_NQ, sizeof(const char *));
+    Q->nss = malloc_or_die(BENCH_NQ, sizeof(size_t));
+    Q->n = 0;
+    char *qdata = malloc_or_die(BENCH_NQ, BENCH_KL);
+
+    PRNG prng;
+    prng_init(&prng, 1);
+
+    // The queries are a random sample of the keys, in the order of insertion; since buckets are chosen by the
+    // hash, the order of the probes is random anyway.
+    for (size_t k = 0; k < BENCH_NK; ++k) {
+        char key[MAX_KEY_LEN];
+        size_t nkey = 4 + gen_word_len_uniform(BENCH_KL - 4);
+        gen_word(key, nkey);
+        table_insert(T, key, nkey, jjhash64_b(key, nkey));
+
+        if (Q->n < BENCH_NQ && prng_next_limit(&prng, BENCH_NK - k) < BENCH_NQ - Q->n) {
+            memcpy(qdata, key, nkey);
+            Q->ss[Q->n] = qdata;
+            Q->nss[Q->n] = nkey;
+            qdata += nkey;
+            ++Q->n;
+        }
+    }
+}
+
+static HASH_FUNC_ATTRS uint64_t hash_jj64_b(const char *s, size_t ns)
+{
+    return jjhash64_b(s, ns);
+}
+
+static HASH_FUNC_ATTRS void hash_jj64_b_many(const char *const *ss, const size_t *nss, size_t n, uint64_t *out)
+{
+    jjhash64_b_many(ss, nss, n, out);
+}
+
+static HASH_FUNC_ATTRS void hash_jjl64_b_prefetch(
+        const char *const *ss, const size_t *nss, size_t n, const Table *T, uint64_t *out)
+{
+    jjhashl64_b_prefetch(ss, nss, n, T->buckets, sizeof(Bucket), T->mask, out);
+}
+
+static inline uint64_t get_utime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// One key at a time: hash, then probe.
+static size_t lookup_one_by_one(const Table *T, const Queries *Q)
+{
+    size_t checksum = 0;
+    for (size_t i = 0; i < Q->n; ++i) {
+        uint64_t h = hash_jj64_b(Q->ss[i], Q->nss[i]);
+        const Bucket *bucket = jjhashl64_bucket(T->buckets, sizeof(Bucket), T->mask, h);
+        checksum += table_find(T, bucket, Q->ss[i], Q->nss[i], h);
+    }
+    return checksum;
+}
+
+// Hash a batch, then probe its buckets; prefetch them if 'prefetch' is set.
+static size_t lookup_batched(const Table *T, const Queries *Q, bool prefetch)
+{
+    size_t checksum = 0;
+    uint64_t hashes[BENCH_BATCH];
+    for (size_t i = 0; i < Q->n; i += BENCH_BATCH) {
+        size_t n = Q->n - i < BENCH_BATCH ? Q->n - i : BENCH_BATCH;
+        if (prefetch) {
+            hash_jjl64_b_prefetch(Q->ss + i, Q->nss + i, n, T, hashes);
+        } else {
+            hash_jj64_b_many(Q->ss + i, Q->nss + i, n, hashes);
+        }
+        for (size_t k = 0; k < n; ++k) {
+            const Bucket *bucket = jjhashl64_bucket(T->buckets, sizeof(Bucket), T->mask, hashes[k]);
+            checksum += table_find(T, bucket, Q->ss[i + k], Q->nss[i + k], hashes[k]);
+        }
+    }
+    return checksum;
+}
+
+int main()
+{
+    gen_word_global_init();
+
+    Table T;
+    Queries Q;
+    gen_table(&T, &Q);
+
+    size_t checksums[3] = {0, 0, 0};
+    uint64_t times[3] = {0, 0, 0};
+    for (int t = 0; t < BENCH_NT; ++t) {
+        uint64_t t0 = get_utime();
+        checksums[0] += lookup_one_by_one(&T, &Q);
+        uint64_t t1 = get_utime();
+        checksums[1] += lookup_batched(&T, &Q, false);
+        uint64_t t2 = get_utime();
+        checksums[2] += lookup_batched(&T, &Q, true);
+        uint64_t t3 = get_utime();
+        times[0] += t1 - t0;
+        times[1] += t2 - t1;
+        times[2] += t3 - t2;
+    }
+
+    if (checksums[0] != checksums[1] || checksums[0] != checksums[2]) {
+        fputs("Lookups differ!\n", stderr);
+        return 1;
+    }
+
+    double nlookups = (double) Q.n * BENCH_NT;
+    long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    printf("table:             %zu MiB (LLC: %ld MiB), %d keys\n",
+           ((T.mask + 1) * sizeof(Bucket)) >> 20, llc > 0 ? llc >> 20 : -1L, BENCH_NK);
+    printf("lookups:           %zu x %d, batch %d\n", Q.n, BENCH_NT, BENCH_BATCH);
+    printf("one by one:        %.2f ns/lookup\n", times[0] / nlookups);
+    printf("batched:           %.2f ns/lookup\n", times[1] / nlookups);
+    printf("batched+prefetch:  %.2f ns/lookup\n", times[2] / nlookups);
+    printf("speedup:           %.2f\n", (double) times[0] / times[2]);
+}
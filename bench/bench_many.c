@@ -0,0 +1,180 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+// Compares hashing keys one by one with jjhash_b with hashing them all at once with jjhash_b_many, for
+// keys of almost equal lengths (L - 3 ... L bytes, as in bench.c) and for ragged ones (uniformly random
+// from 0 to 2 * L bytes, so that the lanes of jjhash_b_many run out of words at very different times).
+//
+// When all the keys are shorter than JJHASH_MANY_MIN_LEN, jjhash_b_many hashes them one by one, and must
+// not be slower than the plain loop: the benchmark fails if its ratio is below 1 - BENCH_SHORT_SLACK.
+
+#include "../utils/common.h"
+#include "../utils/gen_word.h"
+
+#include "../jjhash.h"
+
+#define HASH_FUNC_ATTRS __attribute__((unused, noinline))
+
+// Number of keys.
+#ifndef BENCH_NK
+#define BENCH_NK 4096
+#endif
+
+// Number of bytes to hash for each timed run.
+#ifndef BENCH_TOTAL
+#define BENCH_TOTAL 100000000
+#endif
+
+// Number of timed runs of each function; the fastest one is reported.
+#ifndef BENCH_REPS
+#define BENCH_REPS 7
+#endif
+
+// The spread of the fastest runs from one invocation to the next, on our (noisy) machine: the same build gave ratios of
+// 0.94 to 1.04 for 4-byte keys.
+#ifndef BENCH_SHORT_SLACK
+#define BENCH_SHORT_SLACK 0.1
+#endif
+
+typedef struct {
+    char *data;
+    const char **ss;
+    size_t *nss;
+    size_t nkeys;
+    size_t total_len;
+} Keys;
+
+static Keys gen_keys(size_t nkeys, size_t L, int ragged)
+{
+    size_t max_len = ragged ? 2 * L : L;
+    Keys K = {
+        .data = malloc_or_die(nkeys, max_len + 1),
+        .ss = malloc_or_die(nkeys, sizeof(const char *)),
+        .nss = malloc_or_die(nkeys, sizeof(size_t)),
+        .nkeys = nkeys,
+        .total_len = 0,
+    };
+
+    char *p = K.data;
+    for (size_t k = 0; k < nkeys; ++k) {
+        size_t len = ragged ? gen_word_len_uniform(max_len) : gen_word_len_almost_full(max_len);
+        gen_word(p, len);
+        K.ss[k] = p;
+        K.nss[k] = len;
+        K.total_len += len;
+        p += len;
+    }
+    return K;
+}
+
+static void free_keys(Keys *K)
+{
+    free(K->data);
+    free(K->ss);
+    free(K->nss);
+}
+
+static HASH_FUNC_ATTRS void hash_jj_b(const char *const *ss, const size_t *nss, size_t n, uint32_t *out)
+{
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = jjhash_b(ss[i], nss[i]);
+    }
+}
+
+static HASH_FUNC_ATTRS void hash_jj_b_many(const char *const *ss, const size_t *nss, size_t n, uint32_t *out)
+{
+    jjhash_b_many(ss, nss, n, out);
+}
+
+static inline uint64_t get_utime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+int main()
+{
+    static const size_t LS[] = {4, 8, 16, 32, 64, 128, 256, 1024};
+
+    gen_word_global_init();
+
+    uint32_t *out = malloc_or_die(BENCH_NK, sizeof(uint32_t));
+
+    int slower_on_short = 0;
+
+    printf("%-8s %6s %8s %12s %12s %8s\n", "lengths", "L", "avg", "jjhash_b", "b_many", "ratio");
+    for (int ragged = 0; ragged < 2; ++ragged) {
+        for (size_t i = 0; i < sizeof(LS) / sizeof(LS[0]); ++i) {
+            Keys K = gen_keys(BENCH_NK, LS[i], ragged);
+            size_t nt = 1 + BENCH_TOTAL / (K.total_len + K.nkeys);
+
+            uint32_t xored_hashes = 0;
+            uint64_t t_b = (uint64_t) -1;
+            uint64_t t_many = (uint64_t) -1;
+
+            // The runs of the two functions alternate, so that slow phases of the machine hit both alike.
+            for (int rep = 0; rep < BENCH_REPS; ++rep) {
+                uint64_t t0 = get_utime();
+                for (size_t t = 0; t < nt; ++t) {
+                    hash_jj_b(K.ss, K.nss, K.nkeys, out);
+                    xored_hashes ^= out[t % K.nkeys];
+                }
+                uint64_t t1 = get_utime();
+                for (size_t t = 0; t < nt; ++t) {
+                    hash_jj_b_many(K.ss, K.nss, K.nkeys, out);
+                    xored_hashes ^= out[t % K.nkeys];
+                }
+                uint64_t t2 = get_utime();
+
+                t_b = t1 - t0 < t_b ? t1 - t0 : t_b;
+                t_many = t2 - t1 < t_many ? t2 - t1 : t_many;
+            }
+
+            if (xored_hashes != 0) {
+                fputs("Hashes differ!\n", stderr);
+                return 1;
+            }
+
+            double ratio = (double) t_b / t_many;
+            bool short_keys = (ragged ? 2 * LS[i] : LS[i]) < JJHASH_MANY_MIN_LEN;
+            bool too_slow = short_keys && ratio < 1 - BENCH_SHORT_SLACK;
+            slower_on_short += too_slow;
+            printf("%-8s %6zu %8.1f %10.5f s %10.5f s %8.3f%s\n",
+                   ragged ? "ragged" : "equal", LS[i], (double) K.total_len / K.nkeys,
+                   t_b / 1e9, t_many / 1e9, ratio, too_slow ? "  (short keys: slower!)" : "");
+            free_keys(&K);
+        }
+    }
+
+    free(out);
+
+    if (slower_on_short) {
+        fprintf(stderr, "jjhash_b_many is slower than jjhash_b on short keys (%d cases)!\n", slower_on_short);
+        return 1;
+    }
+}
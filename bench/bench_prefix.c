@@ -0,0 +1,192 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+// Compares jjhash_b with jjhashp_b (hashing with a cache of prefix states) on a path-like corpus:
+// keys are file paths listed in roughly the order a directory walk would produce them, so that
+// consecutive keys share long prefixes.
+
+#include "../utils/common.h"
+#include "../utils/gen_word.h"
+#include "../utils/prng.h"
+
+#include "../jjhash.h"
+#include "../jjhashp.h"
+
+#define HASH_FUNC_ATTRS __attribute__((unused, noinline))
+
+// Number of keys.
+#ifndef BENCH_NK
+#define BENCH_NK 100000
+#endif
+
+// Number of times to hash all the keys.
+#ifndef BENCH_NT
+#define BENCH_NT 50
+#endif
+
+// Number of entries in the prefix cache (a power of 2).
+#ifndef BENCH_NENTRIES
+#define BENCH_NENTRIES 1024
+#endif
+
+// Maximum length of a path component; lengths are uniformly random from 1 to this. The defaults give paths of
+// about 450 bytes, long enough for the cache (with its default settings) to pay off.
+#ifndef BENCH_CL
+#define BENCH_CL 60
+#endif
+
+// Minimum and maximum depth of a directory.
+#ifndef BENCH_MIN_DEPTH
+#define BENCH_MIN_DEPTH 8
+#endif
+#ifndef BENCH_MAX_DEPTH
+#define BENCH_MAX_DEPTH 16
+#endif
+
+enum { NCOMPONENTS = 512 };
+enum { MAX_COMPONENT_LEN = BENCH_CL };
+enum { MIN_DEPTH = BENCH_MIN_DEPTH };
+enum { MAX_DEPTH = BENCH_MAX_DEPTH };
+
+typedef struct {
+    char *data;
+    size_t *offsets;
+    size_t nkeys;
+} Corpus;
+
+static Corpus gen_corpus(size_t nkeys)
+{
+    static char components[NCOMPONENTS][MAX_COMPONENT_LEN];
+    static size_t component_lens[NCOMPONENTS];
+    for (int i = 0; i < NCOMPONENTS; ++i) {
+        component_lens[i] = 1 + gen_word_len_uniform(MAX_COMPONENT_LEN - 1);
+        gen_word(components[i], component_lens[i]);
+    }
+
+    PRNG prng;
+    prng_init(&prng, 1);
+
+    size_t max_key_len = (MAX_DEPTH + 1) * (MAX_COMPONENT_LEN + 1);
+    Corpus C = {
+        .data = malloc_or_die(nkeys, max_key_len),
+        .offsets = malloc_or_die(nkeys + 1, sizeof(size_t)),
+        .nkeys = nkeys,
+    };
+
+    // The current directory, as indices of components.
+    int dir[MAX_DEPTH];
+    size_t depth = 0;
+
+    size_t off = 0;
+    for (size_t k = 0; k < nkeys; ++k) {
+        // Most of the time, stay in the same directory; sometimes, go up a few levels and down again.
+        if (prng_next(&prng) % 8 == 0 || depth < MIN_DEPTH) {
+            size_t up = prng_next_limit(&prng, 3);
+            depth = depth > up ? depth - up : 0;
+            size_t new_depth = MIN_DEPTH + prng_next_limit(&prng, MAX_DEPTH - MIN_DEPTH + 1);
+            for (; depth < new_depth; ++depth) {
+                dir[depth] = prng_next_limit(&prng, NCOMPONENTS);
+            }
+        }
+
+        C.offsets[k] = off;
+        for (size_t i = 0; i < depth; ++i) {
+            C.data[off++] = '/';
+            memcpy(C.data + off, components[dir[i]], component_lens[dir[i]]);
+            off += component_lens[dir[i]];
+        }
+        int file = prng_next_limit(&prng, NCOMPONENTS);
+        C.data[off++] = '/';
+        memcpy(C.data + off, components[file], component_lens[file]);
+        off += component_lens[file];
+    }
+    C.offsets[nkeys] = off;
+
+    return C;
+}
+
+static HASH_FUNC_ATTRS uint32_t hash_jj_b(const char *s, size_t ns)
+{
+    return jjhash_b(s, ns);
+}
+
+static HASH_FUNC_ATTRS uint32_t hash_jjp_b(struct jjhashp_cache *cache, const char *s, size_t ns)
+{
+    return jjhashp_b(cache, s, ns);
+}
+
+static inline uint64_t get_utime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+int main()
+{
+    gen_word_global_init();
+
+    Corpus C = gen_corpus(BENCH_NK);
+
+    static struct jjhashp_entry entries[BENCH_NENTRIES];
+    struct jjhashp_cache cache;
+
+    uint32_t summed_hashes = 0;
+
+    uint64_t t0 = get_utime();
+    for (int t = 0; t < BENCH_NT; ++t) {
+        for (size_t k = 0; k < C.nkeys; ++k) {
+            summed_hashes += hash_jj_b(C.data + C.offsets[k], C.offsets[k + 1] - C.offsets[k]);
+        }
+    }
+    uint64_t t_jj = get_utime() - t0;
+
+    t0 = get_utime();
+    for (int t = 0; t < BENCH_NT; ++t) {
+        // Start each pass with an empty cache, so that only the locality within a pass helps.
+        jjhashp_init(&cache, entries, BENCH_NENTRIES, '/');
+        for (size_t k = 0; k < C.nkeys; ++k) {
+            summed_hashes -= hash_jjp_b(&cache, C.data + C.offsets[k], C.offsets[k + 1] - C.offsets[k]);
+        }
+    }
+    uint64_t t_jjp = get_utime() - t0;
+
+    if (summed_hashes != 0) {
+        fputs("Hashes differ!\n", stderr);
+        return 1;
+    }
+
+    struct jjhashp_stats st = cache.stats;
+    printf("keys:          %zu, average length %.1f\n", C.nkeys, (double) C.offsets[C.nkeys] / C.nkeys);
+    printf("jjhash_b:      %.5f s\n", t_jj / 1e9);
+    printf("jjhashp_b:     %.5f s\n", t_jjp / 1e9);
+    printf("ratio:         %.5f\n", (double) t_jj / t_jjp);
+    printf("hit ratio:     %.4f\n", (double) st.hits / st.keys);
+    printf("short keys:    %.4f\n", (double) st.short_keys / st.keys);
+    printf("bytes saved:   %.4f\n", (double) st.bytes_saved / C.offsets[C.nkeys]);
+    printf("bytes hashed:  %.4f\n", (double) st.bytes_hashed / C.offsets[C.nkeys]);
+}
@@ -0,0 +1,28 @@
+#!/usr/bin/env bash
+
+set -e
+
+# Compares jjhash_b with jjhash_b_short on words of uniformly random lengths from 0 to L,
+# for L = 4...16. Unlike bench.sh, lengths vary from word to word, so that the branches on the
+# length are mispredicted, and there are more words, so that the branch predictor cannot learn
+# the sequence of lengths by heart.
+
+${CC:-gcc} -O3 -Wall -Wextra -march=native bench.c ../utils/{common,gen_word}.c -lm "$@" -o bench
+
+ls=()
+wls=()
+for (( l = 4; l <= 16; ++l )); do
+    # The maximum word length is wl for wl < 8, and wl - 1 otherwise (see gen_dict() in bench.c).
+    ls+=( "$l" )
+    wls+=( $(( l < 8 ? l : l + 1 )) )
+done
+
+# The number of passes for each length is 36621 / wl (150000000 bytes over 4096 words), split into
+# 10 repetitions (see bench.sh); the times are the medians, scaled back.
+$PREFIX ./bench -f jj_b,jj_b_short -r -n 4096 -T $(( 150000000 / 4096 / 10 )) -c auto -w 100 -R 5,100 -e 0.01 -B 3 \
+        -L "$(IFS=,; echo "${wls[*]}")" -o csv |
+    awk -F, -v"ls=${ls[*]}" '
+        BEGIN { split(ls, l, " ") }
+        NR == 1 { next }
+        $1 == "jj_b" { t_jj = 10 * $7; next }
+        { printf("%s\t%.5f\t\t%.5f\t%.5f\n", l[++k], t_jj / (10 * $7), t_jj, 10 * $7) }'
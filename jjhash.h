@@ -34,28 +34,50 @@
 #ifndef JJHASH_ATTRS
 # define JJHASH_ATTRS inline
 #endif
+#ifndef JJHASH_SPLIT_MUL
+# define JJHASH_SPLIT_MUL 0
+#endif
+
+#if defined(__cplusplus) && __cplusplus >= 201103L
+# define JJHASH_CONSTEXPR constexpr
+#else
+# define JJHASH_CONSTEXPR
+#endif
 
 #define JJHASH_PRIME UINT64_C(2752750471)
 #define JJHASH_ACCUM_INIT UINT64_C(0x100000000)
 
-#define JJHASH_ACCUM_FEED(a, v) do { a ^= (v); a *= JJHASH_PRIME; } while (0)
+#if JJHASH_SPLIT_MUL
+// The prime is less than 2**32, so the multiplication is 'lo(a) * PRIME + ((hi(a) * PRIME) << 32)', that
+// is, one widening 32x32->64 multiplication and one truncated 32x32->32 one; the casts make both explicit
+// (with optimizations on, GCC emits 'mull' and 'imull' on i386). Define JJHASH_SPLIT_MUL to 1 on 32-bit
+// targets if the compiler does not figure this out by itself. The constexpr jjhash_u32() and
+// jjhash_u64() use it too.
+# define JJHASH_MUL_PRIME_(a) ( \
+    (uint64_t) (uint32_t) (a) * (uint32_t) JJHASH_PRIME + \
+    ((uint64_t) ((uint32_t) ((a) >> 32) * (uint32_t) JJHASH_PRIME) << 32))
+#else
+# define JJHASH_MUL_PRIME_(a) ((a) * JJHASH_PRIME)
+#endif
+#define JJHASH_ACCUM_FEED(a, v) do { a ^= (v); a = JJHASH_MUL_PRIME_(a); } while (0)
+
 #define JJHASH_ACCUM_FINALIZE(a) do { a ^= a >> 16; a ^= a >> 8; } while (0)
 
-static JJHASH_ATTRS uint32_t jjhash_b(const char *s, size_t ns)
-{
-    uint64_t a = JJHASH_ACCUM_INIT;
+// Fetch 4 bytes in little endian; on x86-64, this optimizes to a single mov instruction.
+#define JJHASH_FETCH_LE32(p) ( \
+    ((uint32_t) (uint8_t) (p)[0]) | \
+    ((uint32_t) (uint8_t) (p)[1] << 8) | \
+    ((uint32_t) (uint8_t) (p)[2] << 16) | \
+    ((uint32_t) (uint8_t) (p)[3] << 24))
 
+// Feeds 'ns' bytes at 's' into accumulator 'a' and returns the new accumulator (not finalized).
+static JJHASH_ATTRS uint64_t jjhash_b_accum_(uint64_t a, const char *s, size_t ns)
+{
     if (ns >= 4) {
         const char *p = s;
         s += (ns & ~3);
         do {
-            // Fetch 4 bytes in little endian; on x86-64, the following 5 lines
-            // optimize to a single mov instruction.
-            uint32_t c0 = (uint8_t) p[0];
-            uint32_t c1 = (uint8_t) p[1];
-            uint32_t c2 = (uint8_t) p[2];
-            uint32_t c3 = (uint8_t) p[3];
-            uint32_t v = c0 | (c1 << 8) | (c2 << 16) | (c3 << 24);
+            uint32_t v = JJHASH_FETCH_LE32(p);
 
             JJHASH_ACCUM_FEED(a, v);
 
@@ -77,6 +99,71 @@ static JJHASH_ATTRS uint32_t jjhash_b(const char *s, size_t ns)
         JJHASH_ACCUM_FEED(a, v);
     }
 
+    return a;
+}
+
+static JJHASH_ATTRS uint32_t jjhash_b(const char *s, size_t ns)
+{
+    uint64_t a = jjhash_b_accum_(JJHASH_ACCUM_INIT, s, ns);
+
+    JJHASH_ACCUM_FINALIZE(a);
+    // Truncations are implementation-defined, so let's do masking.
+    return a & UINT32_C(0xffffffff);
+}
+
+#define JJHASH_SHORT_MAX 16
+
+// Feeds 'v' into accumulator 'a' if 'cond' is true, without branching.
+#define JJHASH_SHORT_FEED_(a, v, cond) do { \
+    uint64_t t_ = a; \
+    uint64_t m_ = 0 - (uint64_t) (cond); \
+    JJHASH_ACCUM_FEED(t_, v); \
+    a = (t_ & m_) | (a & ~m_); \
+} while (0)
+
+// Same as jjhash_b(), but only for 'ns <= JJHASH_SHORT_MAX'.
+//
+// When key lengths vary, the loop and the tail branches of jjhash_b() are often mispredicted. Here,
+// all the words are loaded with 4-byte loads that never go past the key (so the load for the last
+// partial word overlaps with the previous one and gets shifted), and then fed unconditionally; words
+// past the end of the key are discarded with masks, not branches.
+static JJHASH_ATTRS uint32_t jjhash_b_short(const char *s, size_t ns)
+{
+    uint64_t a = JJHASH_ACCUM_INIT;
+
+    uint32_t w0 = 0;
+    uint32_t w1 = 0;
+    uint32_t w2 = 0;
+    uint32_t w3 = 0;
+    if (ns >= 4) {
+        // Word 'k' is loaded from offset 'min(4 * k, ns - 4)' and then shifted right by the number of
+        // bytes that come before offset '4 * k' in the load. Masking the shift only matters for words
+        // past the end of the key, which are discarded anyway.
+        size_t last = ns - 4;
+        size_t o1 = last < 4 ? last : 4;
+        size_t o2 = last < 8 ? last : 8;
+        size_t o3 = last < 12 ? last : 12;
+        const char *p1 = s + o1;
+        const char *p2 = s + o2;
+        const char *p3 = s + o3;
+        w0 = JJHASH_FETCH_LE32(s);
+        w1 = JJHASH_FETCH_LE32(p1) >> ((8 * (4 - o1)) & 31);
+        w2 = JJHASH_FETCH_LE32(p2) >> ((8 * (8 - o2)) & 31);
+        w3 = JJHASH_FETCH_LE32(p3) >> ((8 * (12 - o3)) & 31);
+    } else if (ns) {
+        // 1, 2 or 3 bytes: 's[ns / 2]' is either the first, the second or the last byte.
+        uint32_t c0 = (uint8_t) s[0];
+        uint32_t c1 = (uint8_t) s[ns / 2];
+        uint32_t c2 = (uint8_t) s[ns - 1];
+        w0 = c0 | (c1 << (8 * (ns / 2))) | (c2 << (8 * (ns - 1)));
+    }
+
+    size_t nwords = (ns + 3) / 4;
+    JJHASH_SHORT_FEED_(a, w0, nwords > 0);
+    JJHASH_SHORT_FEED_(a, w1, nwords > 1);
+    JJHASH_SHORT_FEED_(a, w2, nwords > 2);
+    JJHASH_SHORT_FEED_(a, w3, nwords > 3);
+
     JJHASH_ACCUM_FINALIZE(a);
     // Truncations are implementation-defined, so let's do masking.
     return a & UINT32_C(0xffffffff);
@@ -116,4 +203,162 @@ rem_0:
     return a & UINT32_C(0xffffffff);
 }
 
+// Integer keys: 'jjhash_u32(x)' and 'jjhash_u64(x)' are the same as 'jjhash_b()' of the little-endian
+// representation of 'x' (4 and 8 bytes, respectively). These are written as single expressions, so
+// that they are 'constexpr' in C++11.
+
+static JJHASH_ATTRS JJHASH_CONSTEXPR uint64_t jjhash_feed_(uint64_t a, uint32_t v)
+{
+    return JJHASH_MUL_PRIME_(a ^ v);
+}
+
+static JJHASH_ATTRS JJHASH_CONSTEXPR uint64_t jjhash_finalize_tail_(uint64_t a)
+{
+    return a ^ (a >> 8);
+}
+
+static JJHASH_ATTRS JJHASH_CONSTEXPR uint32_t jjhash_finalize_(uint64_t a)
+{
+    // Truncations are implementation-defined, so let's do masking.
+    return jjhash_finalize_tail_(a ^ (a >> 16)) & UINT32_C(0xffffffff);
+}
+
+static JJHASH_ATTRS JJHASH_CONSTEXPR uint32_t jjhash_u32(uint32_t x)
+{
+    return jjhash_finalize_(jjhash_feed_(JJHASH_ACCUM_INIT, x));
+}
+
+static JJHASH_ATTRS JJHASH_CONSTEXPR uint32_t jjhash_u64(uint64_t x)
+{
+    return jjhash_finalize_(
+        jjhash_feed_(
+            jjhash_feed_(JJHASH_ACCUM_INIT, x & UINT32_C(0xffffffff)),
+            x >> 32));
+}
+
+#define JJHASH_MANY_LANES 4
+
+// Strings shorter than this are hashed with jjhash_b() one by one: consecutive calls are independent,
+// so the CPU overlaps them by itself, and the bookkeeping of the lanes does not pay off (see
+// bench/bench_many.c).
+#ifndef JJHASH_MANY_MIN_LEN
+#define JJHASH_MANY_MIN_LEN 256
+#endif
+
+// Number of long strings gathered before they are fed to the lanes.
+#define JJHASH_MANY_CHUNK 64
+
+// Hashes the strings 'idx[0] ... idx[m - 1]' of the batch in the lanes (see jjhash_b_many()).
+static JJHASH_ATTRS void jjhash_b_lanes_(
+        const char *const *ss, const size_t *nss, const size_t *idx, size_t m, uint32_t *out)
+{
+    enum { L = JJHASH_MANY_LANES };
+
+    const char *p[L];
+    size_t np[L];
+    size_t lane[L]; // Index into 'idx' of the lane's string, or 'm' for a lane with no string left.
+    uint64_t a[L];
+    size_t next = 0;
+    int nactive = 0;
+
+    for (int k = 0; k < L; ++k) {
+        a[k] = JJHASH_ACCUM_INIT;
+        if (next != m) {
+            p[k] = ss[idx[next]];
+            np[k] = nss[idx[next]];
+            lane[k] = next++;
+            ++nactive;
+        } else {
+            p[k] = 0;
+            np[k] = 0;
+            lane[k] = m;
+        }
+    }
+
+    while (nactive != 0) {
+        size_t ncommon = (size_t) -1;
+        for (int k = 0; k < L; ++k) {
+            if (lane[k] != m && np[k] < ncommon) {
+                ncommon = np[k];
+            }
+        }
+        ncommon &= ~(size_t) 3;
+
+        if (nactive == L) {
+            for (size_t off = 0; off != ncommon; off += 4) {
+                for (int k = 0; k < L; ++k) {
+                    uint32_t v = JJHASH_FETCH_LE32(p[k]);
+                    JJHASH_ACCUM_FEED(a[k], v);
+                    p[k] += 4;
+                }
+            }
+        } else {
+            // The end of the batch: some lanes have no string left.
+            for (size_t off = 0; off != ncommon; off += 4) {
+                for (int k = 0; k < L; ++k) {
+                    if (lane[k] != m) {
+                        uint32_t v = JJHASH_FETCH_LE32(p[k]);
+                        JJHASH_ACCUM_FEED(a[k], v);
+                        p[k] += 4;
+                    }
+                }
+            }
+        }
+
+        for (int k = 0; k < L; ++k) {
+            if (lane[k] == m) {
+                continue;
+            }
+            np[k] -= ncommon;
+            if (np[k] >= 4) {
+                continue;
+            }
+
+            a[k] = jjhash_b_accum_(a[k], p[k], np[k]);
+            JJHASH_ACCUM_FINALIZE(a[k]);
+            // Truncations are implementation-defined, so let's do masking.
+            out[idx[lane[k]]] = a[k] & UINT32_C(0xffffffff);
+
+            a[k] = JJHASH_ACCUM_INIT;
+            if (next != m) {
+                p[k] = ss[idx[next]];
+                np[k] = nss[idx[next]];
+                lane[k] = next++;
+            } else {
+                lane[k] = m;
+                --nactive;
+            }
+        }
+    }
+}
+
+// Calculates 'out[i] = jjhash_b(ss[i], nss[i])' for each 'i' in '0 ... n'.
+//
+// A single jjhash_b() call is one long chain of dependent multiplications, so its speed is bound
+// by multiplication latency. Here, the strings of at least JJHASH_MANY_MIN_LEN bytes are gathered
+// (up to JJHASH_MANY_CHUNK at a time, in the same pass that hashes the shorter ones one by one),
+// and fed to JJHASH_MANY_LANES independent accumulators in lockstep, so that the multiplications
+// of different strings overlap: all the lanes are fed the whole words they have in common, then the
+// lanes left with less than a whole word are retired (their tails are fed and their hashes are
+// stored) and refilled with the next strings, and so on. This way, all the lanes stay busy until
+// the strings run out, however ragged the lengths are.
+static JJHASH_ATTRS void jjhash_b_many(const char *const *ss, const size_t *nss, size_t n, uint32_t *out)
+{
+    size_t idx[JJHASH_MANY_CHUNK];
+    size_t i = 0;
+    while (i != n) {
+        size_t m = 0;
+        for (; i != n && m != JJHASH_MANY_CHUNK; ++i) {
+            if (nss[i] < JJHASH_MANY_MIN_LEN) {
+                out[i] = jjhash_b(ss[i], nss[i]);
+            } else {
+                idx[m++] = i;
+            }
+        }
+        if (m != 0) {
+            jjhash_b_lanes_(ss, nss, idx, m, out);
+        }
+    }
+}
+
 #endif // JJHASH_INCLUDED__
@@ -0,0 +1,164 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASH_HPP_INCLUDED__
+#define JJHASH_HPP_INCLUDED__
+
+// C++ interface to jjhash (requires C++11).
+//
+//   * jjhash::b(s, ns) and jjhash::b64(s, ns) are 'constexpr' versions of jjhash_b() and jjhash64_b(),
+//     so that strings can be hashed at compile time, e.g. for 'switch' on command names:
+//
+//         using namespace jjhash::literals;
+//         switch (jjhash_b(name, name_len)) {
+//         case "start"_jjhash: ...
+//         case "stop"_jjhash: ...
+//         }
+//
+//     At run time, prefer jjhash_b() and jjhash64_b(), which are faster.
+//
+//   * jjhash::hasher is a transparent hash functor accepting 'std::string', 'std::string_view' (in C++17)
+//     and 'const char *', all of which hash the same for the same content; with a transparent key
+//     equality (e.g. 'std::equal_to<>'), it allows C++20 unordered containers to look up keys without
+//     constructing temporary 'std::string's.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#if __cplusplus >= 201703L
+# include <string_view>
+#endif
+
+#include "jjhash.h"
+#include "jjhash_64/jjhash64.h"
+
+namespace jjhash {
+
+namespace detail {
+
+constexpr uint32_t byte(const char *s, size_t i)
+{
+    return static_cast<uint8_t>(s[i]);
+}
+
+constexpr uint32_t word(const char *s)
+{
+    return byte(s, 0) | (byte(s, 1) << 8) | (byte(s, 2) << 16) | (byte(s, 3) << 24);
+}
+
+// The last 1, 2 or 3 bytes, zero-padded.
+constexpr uint32_t tail(const char *s, size_t ns)
+{
+    return byte(s, 0) | (ns > 1 ? byte(s, 1) << 8 : 0) | (ns > 2 ? byte(s, 2) << 16 : 0);
+}
+
+// C++11 'constexpr' functions consist of a single return statement, so the loop is a (tail) recursion,
+// one level per word. GCC and Clang bound the depth of constant evaluation to 512 by default, so strings
+// (and literals) of more than about 2 KB can only be hashed at compile time with a larger
+// -fconstexpr-depth.
+constexpr uint64_t accum(uint64_t a, const char *s, size_t ns)
+{
+    return ns >= 4 ? accum(jjhash_feed_(a, word(s)), s + 4, ns - 4)
+         : ns      ? jjhash_feed_(a, tail(s, ns))
+         :           a;
+}
+
+} // namespace detail
+
+constexpr uint32_t b(const char *s, size_t ns)
+{
+    return jjhash_finalize_(detail::accum(JJHASH_ACCUM_INIT, s, ns));
+}
+
+constexpr uint64_t b64(const char *s, size_t ns)
+{
+    return jjhash64_finalize_(detail::accum(JJHASH64_ACCUM_INIT, s, ns));
+}
+
+namespace literals {
+
+constexpr uint32_t operator""_jjhash(const char *s, size_t ns)
+{
+    return b(s, ns);
+}
+
+constexpr uint64_t operator""_jjhash64(const char *s, size_t ns)
+{
+    return b64(s, ns);
+}
+
+} // namespace literals
+
+struct hasher {
+    typedef void is_transparent;
+
+    size_t operator()(const char *s) const
+    {
+        return sizeof(size_t) > 4 ? static_cast<size_t>(jjhash64_s(s)) : static_cast<size_t>(jjhash_s(s));
+    }
+
+    size_t operator()(const std::string &s) const
+    {
+        return hash(s.data(), s.size());
+    }
+
+#if __cplusplus >= 201703L
+    size_t operator()(std::string_view s) const
+    {
+        return hash(s.data(), s.size());
+    }
+#endif
+
+private:
+    static size_t hash(const char *s, size_t ns)
+    {
+        return sizeof(size_t) > 4 ? static_cast<size_t>(jjhash64_b(s, ns)) : static_cast<size_t>(jjhash_b(s, ns));
+    }
+};
+
+// Known answers, as computed by jjhash_b() and jjhash64_b() from jjhash.h and jjhash64.h.
+static_assert(b("", 0) == UINT32_C(0x01010100), "jjhash.hpp disagrees with jjhash.h");
+static_assert(b("a", 1) == UINT32_C(0x5e3d688a), "jjhash.hpp disagrees with jjhash.h");
+static_assert(b("abc", 3) == UINT32_C(0xc4a85a51), "jjhash.hpp disagrees with jjhash.h");
+static_assert(b("abcd", 4) == UINT32_C(0xcd993f15), "jjhash.hpp disagrees with jjhash.h");
+static_assert(b("abcdefg", 7) == UINT32_C(0x9fc68658), "jjhash.hpp disagrees with jjhash.h");
+static_assert(b("\xff\x80\x01\x00\xfe\x7f\x00\x10", 8) == UINT32_C(0x89f1e29c), "jjhash.hpp disagrees with jjhash.h");
+static_assert(b("The quick brown fox jumps over the lazy dog", 43) == UINT32_C(0xce49e65d),
+              "jjhash.hpp disagrees with jjhash.h");
+static_assert(b64("", 0) == UINT64_C(0x0000000101010100), "jjhash.hpp disagrees with jjhash64.h");
+static_assert(b64("a", 1) == UINT64_C(0xa4b714d15e3d688a), "jjhash.hpp disagrees with jjhash64.h");
+static_assert(b64("abc", 3) == UINT64_C(0xa4f7a18dc4a85a51), "jjhash.hpp disagrees with jjhash64.h");
+static_assert(b64("abcd", 4) == UINT64_C(0xe48f8d80cd993f15), "jjhash.hpp disagrees with jjhash64.h");
+static_assert(b64("abcdefg", 7) == UINT64_C(0x7e4375659fc68658), "jjhash.hpp disagrees with jjhash64.h");
+static_assert(b64("\xff\x80\x01\x00\xfe\x7f\x00\x10", 8) == UINT64_C(0x317d6e2189f1e29c),
+              "jjhash.hpp disagrees with jjhash64.h");
+static_assert(b64("The quick brown fox jumps over the lazy dog", 43) == UINT64_C(0x359a58e1ce49e65d),
+              "jjhash.hpp disagrees with jjhash64.h");
+
+} // namespace jjhash
+
+#endif // JJHASH_HPP_INCLUDED__
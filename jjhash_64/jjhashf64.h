@@ -0,0 +1,137 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHF64_INCLUDED__
+#define JJHASHF64_INCLUDED__
+
+// Hashing of fixed-size keys.
+//
+// jjhash64_b_N(s) is the same as 'jjhash64_b(s, N)', fully unrolled. The set of N's is configured
+// when generating this file (see templates/gen.sh).
+//
+// In C++, 'jjhash64_b_n<N>(s)' is the same as 'jjhash64_b(s, N)' for any N; it calls jjhash64_b_N() if
+// it has been generated.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "jjhash64.h"
+
+#ifndef JJHASHF64_ATTRS
+# define JJHASHF64_ATTRS inline
+#endif
+
+static JJHASHF64_ATTRS uint64_t jjhash64_b_8(const char *s)
+{
+    uint64_t a = JJHASH64_ACCUM_INIT;
+
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 0));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 4));
+
+    JJHASH64_ACCUM_FINALIZE(a);
+    return a;
+}
+
+static JJHASHF64_ATTRS uint64_t jjhash64_b_16(const char *s)
+{
+    uint64_t a = JJHASH64_ACCUM_INIT;
+
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 0));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 4));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 8));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 12));
+
+    JJHASH64_ACCUM_FINALIZE(a);
+    return a;
+}
+
+static JJHASHF64_ATTRS uint64_t jjhash64_b_20(const char *s)
+{
+    uint64_t a = JJHASH64_ACCUM_INIT;
+
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 0));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 4));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 8));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 12));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 16));
+
+    JJHASH64_ACCUM_FINALIZE(a);
+    return a;
+}
+
+static JJHASHF64_ATTRS uint64_t jjhash64_b_32(const char *s)
+{
+    uint64_t a = JJHASH64_ACCUM_INIT;
+
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 0));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 4));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 8));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 12));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 16));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 20));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 24));
+    JJHASH64_ACCUM_FEED(a, JJHASH64_FETCH_LE32(s + 28));
+
+    JJHASH64_ACCUM_FINALIZE(a);
+    return a;
+}
+
+#ifdef __cplusplus
+
+template<size_t N>
+inline uint64_t jjhash64_b_n(const char *s)
+{
+    return jjhash64_b(s, N);
+}
+
+template<>
+inline uint64_t jjhash64_b_n<8>(const char *s)
+{
+    return jjhash64_b_8(s);
+}
+
+template<>
+inline uint64_t jjhash64_b_n<16>(const char *s)
+{
+    return jjhash64_b_16(s);
+}
+
+template<>
+inline uint64_t jjhash64_b_n<20>(const char *s)
+{
+    return jjhash64_b_20(s);
+}
+
+template<>
+inline uint64_t jjhash64_b_n<32>(const char *s)
+{
+    return jjhash64_b_32(s);
+}
+
+#endif // __cplusplus
+
+#endif // JJHASHF64_INCLUDED__
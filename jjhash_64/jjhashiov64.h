@@ -0,0 +1,72 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHIOV64_INCLUDED__
+#define JJHASHIOV64_INCLUDED__
+
+// Hashing of scatter-gather arrays ('struct iovec', as used by readv()/writev()), without concatenating
+// them first. Unlike jjhash64.h and jjhashx64.h, this requires a POSIX system (for <sys/uio.h>).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include "jjhashx64.h"
+
+#ifndef JJHASHIOV64_ATTRS
+# define JJHASHIOV64_ATTRS inline
+#endif
+
+// Same as calling jjhashx64_stream_update() for each of 'iov[0] ... iov[iovcnt - 1]' in order.
+static JJHASHIOV64_ATTRS void jjhashx64_stream_update_iov(struct jjhashx64_stream *st, const struct iovec *iov, int iovcnt)
+{
+    for (int i = 0; i < iovcnt; ++i) {
+        jjhashx64_stream_update(st, (const char *) iov[i].iov_base, iov[i].iov_len);
+    }
+}
+
+// Same as jjhashx64_b_continue() of the concatenation of 'iov[0] ... iov[iovcnt - 1]'; segments need not
+// be multiples of 4 bytes long, as words are stitched across segment boundaries.
+static JJHASHIOV64_ATTRS struct jjhashx64_state jjhashx64_iov_continue(struct jjhashx64_state state, const struct iovec *iov, int iovcnt)
+{
+    struct jjhashx64_stream st;
+    jjhashx64_stream_init(&st);
+    st.state = state;
+    jjhashx64_stream_update_iov(&st, iov, iovcnt);
+    return jjhashx64_stream_state(&st);
+}
+
+// Same as jjhash64_b() of the concatenation of 'iov[0] ... iov[iovcnt - 1]'.
+static JJHASHIOV64_ATTRS uint64_t jjhash64_iov(const struct iovec *iov, int iovcnt)
+{
+    struct jjhashx64_stream st;
+    jjhashx64_stream_init(&st);
+    jjhashx64_stream_update_iov(&st, iov, iovcnt);
+    return jjhashx64_stream_final(&st);
+}
+
+#endif // JJHASHIOV64_INCLUDED__
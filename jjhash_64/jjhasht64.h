@@ -0,0 +1,171 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHT64_INCLUDED__
+#define JJHASHT64_INCLUDED__
+
+// Tree mode: a different hash function (not compatible with jjhash64_b) whose computation can be split
+// across cores, as the chunks of the input are hashed independently.
+//
+// Version 1 is defined as follows:
+//   * the input is split into chunks of JJHASHT64_CHUNK_SIZE (1 MiB) bytes, the last one possibly shorter
+//     (the empty input has no chunks);
+//   * the hash of each chunk (leaf) is jjhash64_b of the chunk;
+//   * the hash of the input is jjhash64_b of the concatenation of:
+//       - the 4 bytes "JJT1",
+//       - the 8-byte little-endian representations of the leaves, in order,
+//       - the 8-byte little-endian representation of the length of the input.
+// Any change to this definition must come with a new version (and a new tag).
+//
+// This header provides a single-threaded implementation (jjhasht64_b), a streaming one (jjhasht64_stream)
+// and the building blocks for multi-threaded ones (jjhasht64_leaves, jjhasht64_combine); see jjhashtp64.h
+// for one based on POSIX threads. All of them give the same result.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "jjhash64.h"
+#include "jjhashx64.h"
+
+#ifndef JJHASHT64_ATTRS
+# define JJHASHT64_ATTRS inline
+#endif
+
+#define JJHASHT64_VERSION 1
+#define JJHASHT64_CHUNK_SIZE ((size_t) 1 << 20)
+
+// Number of chunks (leaves) for an input of 'ns' bytes.
+#define JJHASHT64_NLEAVES(ns) (((ns) + JJHASHT64_CHUNK_SIZE - 1) / JJHASHT64_CHUNK_SIZE)
+
+static JJHASHT64_ATTRS struct jjhashx64_state jjhasht64_combine_begin_(void)
+{
+    return jjhashx64_b_begin("JJT1", 4);
+}
+
+static JJHASHT64_ATTRS struct jjhashx64_state jjhasht64_combine_u64_(struct jjhashx64_state state, uint64_t x)
+{
+    char buf[8];
+    for (int i = 0; i < 8; ++i) {
+        buf[i] = (char) (unsigned char) (x >> (8 * i));
+    }
+    return jjhashx64_b_continue(state, buf, 8);
+}
+
+// Computes the leaves 'first ... first + count - 1' of the input 's ... s + ns' into 'out'.
+static JJHASHT64_ATTRS void jjhasht64_leaves(const char *s, size_t ns, size_t first, size_t count, uint64_t *out)
+{
+    for (size_t i = 0; i != count; ++i) {
+        size_t off = (first + i) * JJHASHT64_CHUNK_SIZE;
+        size_t n = ns - off < JJHASHT64_CHUNK_SIZE ? ns - off : JJHASHT64_CHUNK_SIZE;
+        out[i] = jjhash64_b(s + off, n);
+    }
+}
+
+// Computes the hash of an input of 'ns' bytes from all of its JJHASHT64_NLEAVES(ns) leaves.
+static JJHASHT64_ATTRS uint64_t jjhasht64_combine(const uint64_t *leaves, size_t ns)
+{
+    struct jjhashx64_state state = jjhasht64_combine_begin_();
+    size_t nleaves = JJHASHT64_NLEAVES(ns);
+    for (size_t i = 0; i != nleaves; ++i) {
+        state = jjhasht64_combine_u64_(state, leaves[i]);
+    }
+    state = jjhasht64_combine_u64_(state, ns);
+    return jjhashx64_finalize_state(state);
+}
+
+// Single-threaded implementation.
+static JJHASHT64_ATTRS uint64_t jjhasht64_b(const char *s, size_t ns)
+{
+    struct jjhashx64_state state = jjhasht64_combine_begin_();
+    size_t nleaves = JJHASHT64_NLEAVES(ns);
+    for (size_t i = 0; i != nleaves; ++i) {
+        uint64_t leaf;
+        jjhasht64_leaves(s, ns, i, 1, &leaf);
+        state = jjhasht64_combine_u64_(state, leaf);
+    }
+    state = jjhasht64_combine_u64_(state, ns);
+    return jjhashx64_finalize_state(state);
+}
+
+// Streaming implementation, for data arriving in chunks of arbitrary sizes; does not buffer the data.
+//
+// struct jjhasht64_stream st;
+// jjhasht64_stream_init(&st);
+// while (... read a chunk (s, ns) ...) {
+//     jjhasht64_stream_update(&st, s, ns);
+// }
+// hash = jjhasht64_stream_final(&st);
+struct jjhasht64_stream {
+    // State of the combination of the leaves so far.
+    struct jjhashx64_state combined;
+    // Stream of the current chunk.
+    struct jjhashx64_stream leaf;
+    // Number of bytes in the current chunk, less than JJHASHT64_CHUNK_SIZE.
+    size_t nleaf;
+    uint64_t total;
+};
+
+static JJHASHT64_ATTRS void jjhasht64_stream_init(struct jjhasht64_stream *st)
+{
+    st->combined = jjhasht64_combine_begin_();
+    jjhashx64_stream_init(&st->leaf);
+    st->nleaf = 0;
+    st->total = 0;
+}
+
+static JJHASHT64_ATTRS void jjhasht64_stream_update(struct jjhasht64_stream *st, const char *s, size_t ns)
+{
+    st->total += ns;
+    while (ns) {
+        size_t n = JJHASHT64_CHUNK_SIZE - st->nleaf;
+        if (n > ns) {
+            n = ns;
+        }
+        jjhashx64_stream_update(&st->leaf, s, n);
+        st->nleaf += n;
+        s += n;
+        ns -= n;
+        if (st->nleaf == JJHASHT64_CHUNK_SIZE) {
+            st->combined = jjhasht64_combine_u64_(st->combined, jjhashx64_stream_final(&st->leaf));
+            jjhashx64_stream_init(&st->leaf);
+            st->nleaf = 0;
+        }
+    }
+}
+
+// Does not modify the stream, so more data can be fed after this.
+static JJHASHT64_ATTRS uint64_t jjhasht64_stream_final(const struct jjhasht64_stream *st)
+{
+    struct jjhashx64_state state = st->combined;
+    if (st->nleaf) {
+        state = jjhasht64_combine_u64_(state, jjhashx64_stream_final(&st->leaf));
+    }
+    state = jjhasht64_combine_u64_(state, st->total);
+    return jjhashx64_finalize_state(state);
+}
+
+#endif // JJHASHT64_INCLUDED__
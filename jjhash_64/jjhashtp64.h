@@ -0,0 +1,110 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHTP64_INCLUDED__
+#define JJHASHTP64_INCLUDED__
+
+// Multi-threaded implementation of the tree mode (see jjhasht64.h), based on POSIX threads; link with -pthread.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "jjhasht64.h"
+
+#ifndef JJHASHTP64_ATTRS
+# define JJHASHTP64_ATTRS inline
+#endif
+
+struct jjhashtp64_job_ {
+    const char *s;
+    size_t ns;
+    size_t first;
+    size_t count;
+    uint64_t *out;
+};
+
+static void *jjhashtp64_worker_(void *arg)
+{
+    struct jjhashtp64_job_ *job = (struct jjhashtp64_job_ *) arg;
+    jjhasht64_leaves(job->s, job->ns, job->first, job->count, job->out);
+    return NULL;
+}
+
+// Same as jjhasht64_b(s, ns), computed by 'nthreads' threads (including the calling one), each hashing a contiguous
+// range of chunks. If memory or threads cannot be allocated, the remaining work is done by the calling thread.
+static JJHASHTP64_ATTRS uint64_t jjhashtp64_b(const char *s, size_t ns, unsigned nthreads)
+{
+    size_t nleaves = JJHASHT64_NLEAVES(ns);
+    if (nthreads > nleaves) {
+        nthreads = (unsigned) nleaves;
+    }
+    if (nthreads <= 1) {
+        return jjhasht64_b(s, ns);
+    }
+
+    uint64_t *leaves = (uint64_t *) malloc(nleaves * sizeof(uint64_t));
+    pthread_t *threads = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+    struct jjhashtp64_job_ *jobs = (struct jjhashtp64_job_ *) malloc(nthreads * sizeof(struct jjhashtp64_job_));
+    if (!leaves || !threads || !jobs) {
+        free(leaves);
+        free(threads);
+        free(jobs);
+        return jjhasht64_b(s, ns);
+    }
+
+    for (unsigned t = 0; t != nthreads; ++t) {
+        size_t first = nleaves * t / nthreads;
+        size_t last = nleaves * (t + 1) / nthreads;
+        struct jjhashtp64_job_ job = {s, ns, first, last - first, leaves + first};
+        jobs[t] = job;
+    }
+
+    // Job 0 is done by the calling thread, as is every job whose thread could not be created.
+    unsigned nstarted = 1;
+    for (; nstarted != nthreads; ++nstarted) {
+        if (pthread_create(&threads[nstarted], NULL, jjhashtp64_worker_, &jobs[nstarted]) != 0) {
+            break;
+        }
+    }
+    for (unsigned t = nstarted; t != nthreads; ++t) {
+        jjhashtp64_worker_(&jobs[t]);
+    }
+    jjhashtp64_worker_(&jobs[0]);
+    for (unsigned t = 1; t != nstarted; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+
+    uint64_t result = jjhasht64_combine(leaves, ns);
+    free(leaves);
+    free(threads);
+    free(jobs);
+    return result;
+}
+
+#endif // JJHASHTP64_INCLUDED__
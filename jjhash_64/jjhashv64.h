@@ -0,0 +1,355 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHV64_INCLUDED__
+#define JJHASHV64_INCLUDED__
+
+// SIMD kernels for batch hashing (see jjhash64_b_many() in jjhash64.h) and for hashing null-terminated
+// strings.
+//
+// Unlike the rest of jjhash, this file is compiler- and platform-dependent: it requires a GNU
+// C-compatible compiler and an x86 target. Each kernel is compiled with its own 'target' attribute,
+// so no special compiler flags are needed, but it is the caller's responsibility to only call a kernel
+// if the CPU supports the corresponding instruction set (e.g. check with __builtin_cpu_supports()).
+//
+// JJHASHV64_HAVE_SSE2, JJHASHV64_HAVE_AVX2 and JJHASHV64_HAVE_AVX512 are defined to 1 if the
+// corresponding kernels are available.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "jjhash64.h"
+#include "jjhashx64.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# include <immintrin.h>
+# define JJHASHV64_HAVE_SSE2 1
+# define JJHASHV64_HAVE_AVX2 1
+# define JJHASHV64_HAVE_AVX512 1
+#endif
+
+#ifndef JJHASHV64_ATTRS
+# define JJHASHV64_ATTRS inline
+#endif
+
+// Offset of 'p' from 'base' as a gather index; the address arithmetic wraps around, so 'p' and 'base'
+// need not point into the same object.
+#define JJHASHV64_OFFSET_(p, base) ((int64_t) ((uintptr_t) (p) - (uintptr_t) (base)))
+
+// Returns the 4-byte word of 's ... s+ns' at offset 'off' as it is fed into the accumulator (that is,
+// with unused bytes of the last partial word set to zero).
+static JJHASHV64_ATTRS uint32_t jjhashv64_word_(const char *s, size_t ns, size_t off)
+{
+    if (ns - off >= 4) {
+        return JJHASH64_FETCH_LE32(s + off);
+    }
+    uint32_t v = 0;
+    switch (ns - off) {
+    case 3:
+        v |= ((uint32_t) (uint8_t) s[off + 2]) << 16;
+        // fallthrough
+    case 2:
+        v |= ((uint32_t) (uint8_t) s[off + 1]) << 8;
+        // fallthrough
+    case 1:
+        v |= (uint8_t) s[off];
+    }
+    return v;
+}
+
+#if JJHASHV64_HAVE_SSE2
+
+// Feeds the null-terminated string 's' into accumulator 'a' and returns the new accumulator (not
+// finalized).
+//
+// Instead of checking every byte for the terminator, this loads aligned 16-byte blocks and finds zero
+// bytes in them with pcmpeqb; whole 4-byte words are fed while no terminator has been seen. An aligned
+// load never crosses a page boundary, so reading the rest of the block past the terminator is safe
+// (but it does upset memory checkers such as AddressSanitizer or Valgrind).
+__attribute__((target("sse2")))
+static JJHASHV64_ATTRS uint64_t jjhashv64_s_accum_sse2_(uint64_t a, const char *s)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    const char *blk = s - ((uintptr_t) s & 15);
+    const char *safe = blk + 16;
+    // Bit 'i' of 'mask' is set if s[i] is zero.
+    unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) blk), zero));
+    mask >>= (s - blk);
+
+    while (!mask) {
+        // Bytes from 's' up to 'safe' are known to be non-zero.
+        while (safe - s >= 4) {
+            uint32_t v = JJHASH64_FETCH_LE32(s);
+            JJHASH64_ACCUM_FEED(a, v);
+            s += 4;
+        }
+        blk = safe;
+        safe += 16;
+        mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) blk), zero));
+        // Up to 3 bytes before 'blk' have not been fed yet; they are known to be non-zero.
+        mask <<= (blk - s);
+    }
+
+    return jjhash64_b_accum_(a, s, __builtin_ctz(mask));
+}
+
+// Same as jjhash64_s().
+__attribute__((target("sse2")))
+static JJHASHV64_ATTRS uint64_t jjhashv64_s_sse2(const char *s)
+{
+    uint64_t a = jjhashv64_s_accum_sse2_(JJHASH64_ACCUM_INIT, s);
+
+    JJHASH64_ACCUM_FINALIZE(a);
+    return a;
+}
+
+// Same as jjhashx64_s_continue().
+__attribute__((target("sse2")))
+static JJHASHV64_ATTRS struct jjhashx64_state jjhashv64_s_continue_sse2(struct jjhashx64_state state, const char *s)
+{
+    struct jjhashx64_state r = {jjhashv64_s_accum_sse2_(state.the_state, s)};
+    return r;
+}
+
+#endif // JJHASHV64_HAVE_SSE2
+
+#if JJHASHV64_HAVE_AVX2
+
+// The prime fits in 32 bits, so the 64x64 multiplication modulo 2**64 is
+//     lo(a) * PRIME + ((hi(a) * PRIME) << 32),
+// which is two 32x32->64 multiplications (vpmuludq).
+__attribute__((target("avx2")))
+static JJHASHV64_ATTRS __m256i jjhashv64_feed_avx2_(__m256i a, __m256i v)
+{
+    const __m256i prime = _mm256_set1_epi64x(JJHASH64_PRIME);
+    a = _mm256_xor_si256(a, v);
+    __m256i lo = _mm256_mul_epu32(a, prime);
+    __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+}
+
+// Calculates 'out[i] = jjhash64_b(ss[i], nss[i])' for each 'i' in '0 ... n', 4 strings at a time.
+__attribute__((target("avx2")))
+static JJHASHV64_ATTRS void jjhashv64_b_many_avx2(const char *const *ss, const size_t *nss, size_t n, uint64_t *out)
+{
+    enum { L = 4 };
+
+    size_t nfull = n - n % L;
+    size_t i = 0;
+    for (; i != nfull; i += L) {
+        const char *const *p = ss + i;
+        const size_t *np = nss + i;
+
+        size_t nmin = np[0];
+        size_t nmax = np[0];
+        for (int k = 1; k < L; ++k) {
+            if (np[k] < nmin) {
+                nmin = np[k];
+            }
+            if (np[k] > nmax) {
+                nmax = np[k];
+            }
+        }
+
+        // Words are gathered from the lanes by their offsets from 'base'.
+        const int *base = (const int *) p[0];
+        __m256i idx = _mm256_set_epi64x(
+            JJHASHV64_OFFSET_(p[3], base),
+            JJHASHV64_OFFSET_(p[2], base),
+            JJHASHV64_OFFSET_(p[1], base),
+            0);
+        const __m256i four = _mm256_set1_epi64x(4);
+
+        __m256i a = _mm256_set1_epi64x(JJHASH64_ACCUM_INIT);
+
+        // Whole words common to all the lanes.
+        size_t off = 0;
+        for (; off != (nmin & ~3); off += 4) {
+            __m256i v = _mm256_cvtepu32_epi64(_mm256_i64gather_epi32(base, idx, 1));
+            a = jjhashv64_feed_avx2_(a, v);
+            idx = _mm256_add_epi64(idx, four);
+        }
+
+        // The rest: lanes that have already been fed all of their words are masked out, and the last
+        // partial word of a lane is assembled bytewise, so that we never read past the end of a string.
+        __m256i rem = _mm256_set_epi64x(
+            (int64_t) (np[3] - off),
+            (int64_t) (np[2] - off),
+            (int64_t) (np[1] - off),
+            (int64_t) (np[0] - off));
+        for (; off < nmax; off += 4) {
+            __m256i active = _mm256_cmpgt_epi64(rem, _mm256_setzero_si256());
+            __m256i whole = _mm256_cmpgt_epi64(rem, _mm256_set1_epi64x(3));
+
+            // Compress the 64-bit lane mask into a 32-bit one, as expected by the gather.
+            __m128i whole32 = _mm256_castsi256_si128(
+                _mm256_permutevar8x32_epi32(whole, _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0)));
+            __m256i v = _mm256_cvtepu32_epi64(
+                _mm256_mask_i64gather_epi32(_mm_setzero_si128(), base, idx, whole32, 1));
+
+            int partial = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_andnot_si256(whole, active)));
+            if (partial) {
+                uint64_t buf[L] = {0};
+                for (int k = 0; k < L; ++k) {
+                    if (partial & (1 << k)) {
+                        buf[k] = jjhashv64_word_(p[k], np[k], off);
+                    }
+                }
+                v = _mm256_or_si256(v, _mm256_loadu_si256((const __m256i *) buf));
+            }
+
+            a = _mm256_blendv_epi8(a, jjhashv64_feed_avx2_(a, v), active);
+            idx = _mm256_add_epi64(idx, four);
+            rem = _mm256_sub_epi64(rem, four);
+        }
+
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 16));
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 8));
+
+        uint64_t buf[L];
+        _mm256_storeu_si256((__m256i *) buf, a);
+        for (int k = 0; k < L; ++k) {
+            out[i + k] = buf[k];
+        }
+    }
+
+    for (; i != n; ++i) {
+        out[i] = jjhash64_b(ss[i], nss[i]);
+    }
+}
+
+#endif // JJHASHV64_HAVE_AVX2
+
+#if JJHASHV64_HAVE_AVX512
+
+// See jjhashv64_feed_avx2_().
+__attribute__((target("avx512f")))
+static JJHASHV64_ATTRS __m512i jjhashv64_feed_avx512_(__m512i a, __m512i v)
+{
+    const __m512i prime = _mm512_set1_epi64(JJHASH64_PRIME);
+    a = _mm512_xor_si512(a, v);
+    __m512i lo = _mm512_mul_epu32(a, prime);
+    __m512i hi = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), prime);
+    return _mm512_add_epi64(lo, _mm512_slli_epi64(hi, 32));
+}
+
+// Calculates 'out[i] = jjhash64_b(ss[i], nss[i])' for each 'i' in '0 ... n', 8 strings at a time.
+// See jjhashv64_b_many_avx2() for the details.
+__attribute__((target("avx512f")))
+static JJHASHV64_ATTRS void jjhashv64_b_many_avx512(const char *const *ss, const size_t *nss, size_t n, uint64_t *out)
+{
+    enum { L = 8 };
+
+    size_t nfull = n - n % L;
+    size_t i = 0;
+    for (; i != nfull; i += L) {
+        const char *const *p = ss + i;
+        const size_t *np = nss + i;
+
+        size_t nmin = np[0];
+        size_t nmax = np[0];
+        for (int k = 1; k < L; ++k) {
+            if (np[k] < nmin) {
+                nmin = np[k];
+            }
+            if (np[k] > nmax) {
+                nmax = np[k];
+            }
+        }
+
+        const int *base = (const int *) p[0];
+        __m512i idx = _mm512_set_epi64(
+            JJHASHV64_OFFSET_(p[7], base),
+            JJHASHV64_OFFSET_(p[6], base),
+            JJHASHV64_OFFSET_(p[5], base),
+            JJHASHV64_OFFSET_(p[4], base),
+            JJHASHV64_OFFSET_(p[3], base),
+            JJHASHV64_OFFSET_(p[2], base),
+            JJHASHV64_OFFSET_(p[1], base),
+            0);
+        const __m512i four = _mm512_set1_epi64(4);
+
+        __m512i a = _mm512_set1_epi64(JJHASH64_ACCUM_INIT);
+
+        size_t off = 0;
+        for (; off != (nmin & ~3); off += 4) {
+            __m512i v = _mm512_cvtepu32_epi64(_mm512_i64gather_epi32(idx, base, 1));
+            a = jjhashv64_feed_avx512_(a, v);
+            idx = _mm512_add_epi64(idx, four);
+        }
+
+        __m512i rem = _mm512_set_epi64(
+            (int64_t) (np[7] - off),
+            (int64_t) (np[6] - off),
+            (int64_t) (np[5] - off),
+            (int64_t) (np[4] - off),
+            (int64_t) (np[3] - off),
+            (int64_t) (np[2] - off),
+            (int64_t) (np[1] - off),
+            (int64_t) (np[0] - off));
+        for (; off < nmax; off += 4) {
+            __mmask8 active = _mm512_cmpgt_epi64_mask(rem, _mm512_setzero_si512());
+            __mmask8 whole = _mm512_cmpgt_epi64_mask(rem, _mm512_set1_epi64(3));
+
+            __m512i v = _mm512_cvtepu32_epi64(
+                _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), whole, idx, base, 1));
+
+            __mmask8 partial = active & ~whole;
+            if (partial) {
+                uint64_t buf[L] = {0};
+                for (int k = 0; k < L; ++k) {
+                    if (partial & (1 << k)) {
+                        buf[k] = jjhashv64_word_(p[k], np[k], off);
+                    }
+                }
+                v = _mm512_or_si512(v, _mm512_loadu_si512(buf));
+            }
+
+            a = _mm512_mask_mov_epi64(a, active, jjhashv64_feed_avx512_(a, v));
+            idx = _mm512_add_epi64(idx, four);
+            rem = _mm512_sub_epi64(rem, four);
+        }
+
+        a = _mm512_xor_si512(a, _mm512_srli_epi64(a, 16));
+        a = _mm512_xor_si512(a, _mm512_srli_epi64(a, 8));
+
+        uint64_t buf[L];
+        _mm512_storeu_si512(buf, a);
+        for (int k = 0; k < L; ++k) {
+            out[i + k] = buf[k];
+        }
+    }
+
+    for (; i != n; ++i) {
+        out[i] = jjhash64_b(ss[i], nss[i]);
+    }
+}
+
+#endif // JJHASHV64_HAVE_AVX512
+
+#endif // JJHASHV64_INCLUDED__
@@ -37,12 +37,27 @@
 #ifndef JJHASHX64_ATTRS_BIG
 # define JJHASHX64_ATTRS_BIG inline
 #endif
+#ifndef JJHASHX64_SPLIT_MUL
+# define JJHASHX64_SPLIT_MUL 0
+#endif
 
 #define JJHASHX64_PRIME UINT64_C(2752750471)
 #define JJHASHX64_PRIME_MODINV UINT64_C(5082482002835059255)
 #define JJHASHX64_ACCUM_INIT UINT64_C(0x100000000)
 
-#define JJHASHX64_ACCUM_FEED(a, v) do { a ^= (v); a *= JJHASHX64_PRIME; } while (0)
+#if JJHASHX64_SPLIT_MUL
+// The prime is less than 2**32, so the multiplication is 'lo(a) * PRIME + ((hi(a) * PRIME) << 32)', that
+// is, one widening 32x32->64 multiplication and one truncated 32x32->32 one; the casts make both explicit
+// (with optimizations on, GCC emits 'mull' and 'imull' on i386). Define JJHASHX64_SPLIT_MUL to 1 on 32-bit
+// targets if the compiler does not figure this out by itself.
+# define JJHASHX64_MUL_PRIME_(a) ( \
+    (uint64_t) (uint32_t) (a) * (uint32_t) JJHASHX64_PRIME + \
+    ((uint64_t) ((uint32_t) ((a) >> 32) * (uint32_t) JJHASHX64_PRIME) << 32))
+#else
+# define JJHASHX64_MUL_PRIME_(a) ((a) * JJHASHX64_PRIME)
+#endif
+#define JJHASHX64_ACCUM_FEED(a, v) do { a ^= (v); a = JJHASHX64_MUL_PRIME_(a); } while (0)
+
 #define JJHASHX64_ACCUM_FINALIZE(a) do { a^= a >> 16; a ^= a >> 8; } while (0)
 
 #define JJHASHX64_RETURN_STATE(a) do { struct jjhashx64_state r_ = {a}; return r_; } while (0)
@@ -207,4 +222,242 @@ static JJHASHX64_ATTRS_BIG struct jjhashx64_state jjhashx64_undo(struct jjhashx6
     JJHASHX64_RETURN_STATE(a);
 }
 
+// Streaming: hashing data that arrives in chunks of arbitrary sizes.
+//
+// jjhashx64_b_continue() only works if every chunk but the last one is a multiple of 4 bytes long.
+// A stream keeps up to 3 bytes of the last incomplete word internally, so that any chunk sizes work:
+//
+// struct jjhashx64_stream st;
+// jjhashx64_stream_init(&st);
+// while (... read a chunk (s, ns) ...) {
+//     jjhashx64_stream_update(&st, s, ns);
+// }
+// hash = jjhashx64_stream_final(&st);
+//
+// The result is the same as jjhashx64_b() of the concatenation of all the chunks.
+struct jjhashx64_stream {
+    // State of all the whole words fed so far.
+    struct jjhashx64_state state;
+    // Bytes of the incomplete word, little-endian.
+    uint32_t pending;
+    // Number of bytes in 'pending', 0 to 3.
+    unsigned npending;
+};
+
+static JJHASHX64_ATTRS_SMALL void jjhashx64_stream_init(struct jjhashx64_stream *st)
+{
+    st->state.the_state = JJHASHX64_ACCUM_INIT;
+    st->pending = 0;
+    st->npending = 0;
+}
+
+static JJHASHX64_ATTRS_BIG void jjhashx64_stream_update(struct jjhashx64_stream *st, const char *s, size_t ns)
+{
+    uint32_t pending = st->pending;
+    unsigned npending = st->npending;
+
+    if (npending) {
+        for (; npending != 4 && ns; ++npending, ++s, --ns) {
+            uint32_t c = (uint8_t) *s;
+            pending |= c << (8 * npending);
+        }
+        if (npending != 4) {
+            st->pending = pending;
+            st->npending = npending;
+            return;
+        }
+        uint64_t a = st->state.the_state;
+        JJHASHX64_ACCUM_FEED(a, pending);
+        st->state.the_state = a;
+        pending = 0;
+        npending = 0;
+    }
+
+    size_t nwhole = ns & ~3;
+    if (nwhole) {
+        st->state = jjhashx64_b_continue(st->state, s, nwhole);
+        s += nwhole;
+        ns -= nwhole;
+    }
+
+    for (; npending != ns; ++npending) {
+        uint32_t c = (uint8_t) s[npending];
+        pending |= c << (8 * npending);
+    }
+    st->pending = pending;
+    st->npending = npending;
+}
+
+// Returns the state as if all the data fed so far were passed to jjhashx64_b_begin(), e.g. to save it
+// or to use with jjhashx64_undo().
+static JJHASHX64_ATTRS_SMALL struct jjhashx64_state jjhashx64_stream_state(const struct jjhashx64_stream *st)
+{
+    uint64_t a = st->state.the_state;
+    if (st->npending) {
+        JJHASHX64_ACCUM_FEED(a, st->pending);
+    }
+    JJHASHX64_RETURN_STATE(a);
+}
+
+// Does not modify the stream, so more data can be fed after this.
+static JJHASHX64_ATTRS_SMALL uint64_t jjhashx64_stream_final(const struct jjhashx64_stream *st)
+{
+    return jjhashx64_finalize_state(jjhashx64_stream_state(st));
+}
+
+// Checkpoints: a stream and the number of bytes fed into it, serialized into JJHASHX64_CHECKPOINT_SIZE bytes, so that
+// hashing of a growing file can be resumed after a restart (see jjhashcp64.h for the file helpers).
+//
+// Version 1 of the format (all integers are little-endian):
+//   * bytes 0...3: "JJCP";
+//   * byte 4: version (1);
+//   * byte 5: number of pending bytes (length modulo 4);
+//   * bytes 6...7: zero;
+//   * bytes 8...15: the state of the whole words;
+//   * bytes 16...23: the length;
+//   * bytes 24...26: the pending bytes, zero-padded;
+//   * byte 27: zero;
+//   * bytes 28...31: the lower 32 bits of jjhashx64_b() (same as jjhashx_b()) of bytes 0...27.
+// The accumulators of jjhashx and jjhashx64 are the same, so checkpoints can be used with either of them.
+
+#define JJHASHX64_CHECKPOINT_VERSION 1
+#define JJHASHX64_CHECKPOINT_SIZE 32
+
+static JJHASHX64_ATTRS_SMALL void jjhashx64_put_le_(unsigned char *p, uint64_t x, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        p[i] = (unsigned char) ((x >> (8 * i)) & 0xff);
+    }
+}
+
+static JJHASHX64_ATTRS_SMALL uint64_t jjhashx64_get_le_(const unsigned char *p, int n)
+{
+    uint64_t x = 0;
+    for (int i = 0; i < n; ++i) {
+        x |= ((uint64_t) p[i]) << (8 * i);
+    }
+    return x;
+}
+
+static JJHASHX64_ATTRS_SMALL uint32_t jjhashx64_checkpoint_check_(const unsigned char *p)
+{
+    struct jjhashx64_state state = jjhashx64_b_begin((const char *) p, 28);
+    uint64_t a = state.the_state;
+    JJHASHX64_ACCUM_FINALIZE(a);
+    return (uint32_t) (a & UINT32_C(0xffffffff));
+}
+
+// Serializes the stream 'st', into which 'length' bytes were fed, into 'out'.
+static JJHASHX64_ATTRS_BIG void jjhashx64_checkpoint_save(
+        const struct jjhashx64_stream *st,
+        uint64_t length,
+        unsigned char out[JJHASHX64_CHECKPOINT_SIZE])
+{
+    out[0] = 'J';
+    out[1] = 'J';
+    out[2] = 'C';
+    out[3] = 'P';
+    out[4] = JJHASHX64_CHECKPOINT_VERSION;
+    out[5] = (unsigned char) st->npending;
+    out[6] = 0;
+    out[7] = 0;
+    jjhashx64_put_le_(out + 8, st->state.the_state, 8);
+    jjhashx64_put_le_(out + 16, length, 8);
+    jjhashx64_put_le_(out + 24, st->pending, 4);
+    jjhashx64_put_le_(out + 28, jjhashx64_checkpoint_check_(out), 4);
+}
+
+// Deserializes a checkpoint. Returns 0 on success, or -1 if it is malformed or corrupted, or has an unknown version.
+static JJHASHX64_ATTRS_BIG int jjhashx64_checkpoint_load(
+        const unsigned char in[JJHASHX64_CHECKPOINT_SIZE],
+        struct jjhashx64_stream *st,
+        uint64_t *length)
+{
+    if (in[0] != 'J' || in[1] != 'J' || in[2] != 'C' || in[3] != 'P' || in[4] != JJHASHX64_CHECKPOINT_VERSION) {
+        return -1;
+    }
+    if (jjhashx64_get_le_(in + 28, 4) != jjhashx64_checkpoint_check_(in)) {
+        return -1;
+    }
+    uint64_t len = jjhashx64_get_le_(in + 16, 8);
+    unsigned npending = in[5];
+    if (npending != (len & 3) || in[6] || in[7] || in[27] || (jjhashx64_get_le_(in + 24, 3) >> (8 * npending))) {
+        return -1;
+    }
+    st->state.the_state = jjhashx64_get_le_(in + 8, 8);
+    st->pending = (uint32_t) jjhashx64_get_le_(in + 24, 3);
+    st->npending = npending;
+    *length = len;
+    return 0;
+}
+
+// Prefix index: hashes of all prefixes of a string.
+//
+// The index keeps the states of the prefixes s[0 ... 4*step*i) (every 'step'-th word boundary), so the hash
+// of any prefix s[0 ... n) takes hashing at most 4*step-1 bytes. For example, to look up all the ancestors
+// of a path ("/a", "/a/b", "/a/b/c", ...) in linear rather than quadratic time:
+//
+// struct jjhashx64_state states[JJHASHX64_PREFIX_INDEX_NSTATES(PATH_MAX, 1)];
+// struct jjhashx64_prefix_index idx;
+// jjhashx64_prefix_index_init(&idx, path, path_len, 1, states);
+// for (size_t n = 1; n <= path_len; ++n) {
+//     if (n == path_len || path[n] == '/') {
+//         hash = jjhashx64_prefix_index_hash(&idx, n);
+//         ...
+//     }
+// }
+//
+// The index does not copy the string, so the string must outlive it.
+
+// Number of states needed for a string of length 'ns' with the given 'step' (in words).
+#define JJHASHX64_PREFIX_INDEX_NSTATES(ns, step) ((ns) / (4 * (size_t) (step)) + 1)
+
+struct jjhashx64_prefix_index {
+    const char *s;
+    size_t ns;
+    // Distance between the checkpoints, in bytes; a multiple of 4.
+    size_t step_bytes;
+    // JJHASHX64_PREFIX_INDEX_NSTATES(ns, step) states; states[i] is the state of s[0 ... step_bytes*i).
+    struct jjhashx64_state *states;
+};
+
+// 'states' must have room for JJHASHX64_PREFIX_INDEX_NSTATES(ns, step) states; 'step' must be at least 1.
+static JJHASHX64_ATTRS_BIG void jjhashx64_prefix_index_init(
+        struct jjhashx64_prefix_index *idx,
+        const char *s,
+        size_t ns,
+        size_t step,
+        struct jjhashx64_state *states)
+{
+    size_t step_bytes = 4 * step;
+    size_t nstates = JJHASHX64_PREFIX_INDEX_NSTATES(ns, step);
+
+    idx->s = s;
+    idx->ns = ns;
+    idx->step_bytes = step_bytes;
+    idx->states = states;
+
+    struct jjhashx64_state state = {JJHASHX64_ACCUM_INIT};
+    states[0] = state;
+    for (size_t i = 1; i != nstates; ++i) {
+        state = jjhashx64_b_continue(state, s, step_bytes);
+        s += step_bytes;
+        states[i] = state;
+    }
+}
+
+// Returns the state of s[0 ... n), as jjhashx64_b_begin(s, n) would; 'n' must not exceed the length of the string.
+static JJHASHX64_ATTRS_SMALL struct jjhashx64_state jjhashx64_prefix_index_state(const struct jjhashx64_prefix_index *idx, size_t n)
+{
+    size_t i = n / idx->step_bytes;
+    size_t base = i * idx->step_bytes;
+    return jjhashx64_b_continue(idx->states[i], idx->s + base, n - base);
+}
+
+// Returns the hash of s[0 ... n), same as jjhashx64_b(s, n).
+static JJHASHX64_ATTRS_SMALL uint64_t jjhashx64_prefix_index_hash(const struct jjhashx64_prefix_index *idx, size_t n)
+{
+    return jjhashx64_finalize_state(jjhashx64_prefix_index_state(idx, n));
+}
+
 #endif // JJHASHX64_INCLUDED__
@@ -0,0 +1,140 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHA_INCLUDED__
+#define JJHASHA_INCLUDED__
+
+// Batch hashing of string columns in the Arrow layout: one contiguous data buffer, an offsets array (int32_t or
+// int64_t) with the string in row 'i' being 'data[offsets[i]] ... data[offsets[i + 1] - 1]', and an optional
+// validity bitmap (bit 'i % 8' of byte 'i / 8' is set if row 'i' is not null).
+//
+// jjhasha_b_i32() and jjhasha_b_i64() hash the rows 'begin ... end - 1' into 'out[0] ... out[end - begin - 1]',
+// with the same result as jjhash_b() of each string, or JJHASHA_NULL_HASH for null rows. They do not convert
+// the column into pointer-and-length pairs in memory; rows are hashed in blocks of JJHASHA_BLOCK with
+// jjhash_b_many(), and the data of the rows JJHASHA_PREFETCH_DISTANCE rows ahead is prefetched. To split the
+// work between threads, give each of them a range of rows (and the corresponding part of the hash column).
+//
+// As in Arrow, the offsets of null rows must still be valid (non-decreasing and within the data buffer), but their
+// data is not hashed: the non-null rows of each block are compacted before jjhash_b_many().
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "jjhash.h"
+
+#ifndef JJHASHA_ATTRS
+# define JJHASHA_ATTRS inline
+#endif
+#ifndef JJHASHA_NULL_HASH
+# define JJHASHA_NULL_HASH 0
+#endif
+#ifndef JJHASHA_PREFETCH_DISTANCE
+# define JJHASHA_PREFETCH_DISTANCE 16
+#endif
+
+#if defined(__GNUC__)
+# define JJHASHA_PREFETCH(p) __builtin_prefetch((p), 0, 3)
+#else
+# define JJHASHA_PREFETCH(p) ((void) (p))
+#endif
+
+#define JJHASHA_BLOCK (4 * JJHASH_MANY_LANES)
+
+// Offset of row 'i', from whichever of 'offsets32' and 'offsets64' is not NULL (constant once inlined).
+static JJHASHA_ATTRS int64_t jjhasha_offset_(const int32_t *offsets32, const int64_t *offsets64, size_t i)
+{
+    return offsets32 ? (int64_t) offsets32[i] : offsets64[i];
+}
+
+static JJHASHA_ATTRS void jjhasha_b_(
+        const char *data,
+        const int32_t *offsets32,
+        const int64_t *offsets64,
+        const uint8_t *validity,
+        size_t begin,
+        size_t end,
+        uint32_t *out)
+{
+    const char *ss[JJHASHA_BLOCK];
+    size_t nss[JJHASHA_BLOCK];
+    // With a validity bitmap, the non-null rows of a block are compacted into 'ss' and 'nss', hashed into 'hs', and
+    // scattered back to their rows 'ks'.
+    size_t ks[JJHASHA_BLOCK];
+    uint32_t hs[JJHASHA_BLOCK];
+    for (size_t i = begin; i < end; i += JJHASHA_BLOCK) {
+        size_t n = end - i < JJHASHA_BLOCK ? end - i : JJHASHA_BLOCK;
+        uint32_t *block_out = out + (i - begin);
+        size_t m = 0;
+        for (size_t k = 0; k != n; ++k) {
+            size_t row = i + k;
+            if (end - row > JJHASHA_PREFETCH_DISTANCE) {
+                JJHASHA_PREFETCH(data + jjhasha_offset_(offsets32, offsets64, row + JJHASHA_PREFETCH_DISTANCE));
+            }
+            if (validity && !((validity[row >> 3] >> (row & 7)) & 1)) {
+                block_out[k] = JJHASHA_NULL_HASH;
+                continue;
+            }
+            int64_t offset = jjhasha_offset_(offsets32, offsets64, row);
+            ss[m] = data + offset;
+            nss[m] = (size_t) (jjhasha_offset_(offsets32, offsets64, row + 1) - offset);
+            ks[m] = k;
+            ++m;
+        }
+        if (m == n) {
+            jjhash_b_many(ss, nss, n, block_out);
+        } else {
+            jjhash_b_many(ss, nss, m, hs);
+            for (size_t j = 0; j != m; ++j) {
+                block_out[ks[j]] = hs[j];
+            }
+        }
+    }
+}
+
+static JJHASHA_ATTRS void jjhasha_b_i32(
+        const char *data,
+        const int32_t *offsets,
+        const uint8_t *validity,
+        size_t begin,
+        size_t end,
+        uint32_t *out)
+{
+    jjhasha_b_(data, offsets, NULL, validity, begin, end, out);
+}
+
+static JJHASHA_ATTRS void jjhasha_b_i64(
+        const char *data,
+        const int64_t *offsets,
+        const uint8_t *validity,
+        size_t begin,
+        size_t end,
+        uint32_t *out)
+{
+    jjhasha_b_(data, NULL, offsets, validity, begin, end, out);
+}
+
+#endif // JJHASHA_INCLUDED__
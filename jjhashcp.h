@@ -0,0 +1,275 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHCP_INCLUDED__
+#define JJHASHCP_INCLUDED__
+
+// Resumable hashing of growing (e.g. append-only) files, based on the checkpoints of jjhashx.h. Requires a POSIX
+// system, and POSIX.1-2008 declarations (pread(), O_CLOEXEC, O_DIRECTORY): in a strict ISO C mode (e.g. -std=c99),
+// define _POSIX_C_SOURCE to 200809L (or _XOPEN_SOURCE to 700) before including any header. Offsets are passed to
+// pread() as off_t, which must be 64-bit: on 32-bit glibc systems, also define _FILE_OFFSET_BITS to 64, or files
+// over 2 GiB could not be hashed (the header does not compile otherwise).
+//
+// struct jjhashx_stream st;
+// uint64_t length;
+// if (jjhashcp_load_file("log.jjcp", &st, &length) != 0) {
+//     jjhashx_stream_init(&st);
+//     length = 0;
+// }
+// if (jjhashcp_resume(fd, &st, &length) == 0) { // only reads the bytes appended since the checkpoint
+//     hash = jjhashx_stream_final(&st);
+//     jjhashcp_save_file("log.jjcp", &st, length);
+// }
+//
+// jjhashcp_resume() checks that the file is not shorter than the checkpoint and that its last incomplete word
+// is still the same, which catches truncations, but not rewrites of the earlier data; jjhashcp_verify() re-reads
+// the whole prefix to check that.
+//
+// The functions return 0 on success, JJHASHCP_MISMATCH if the file does not match the checkpoint, or an errno
+// value on I/O errors.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if !defined(O_CLOEXEC) || !defined(O_DIRECTORY)
+# error "jjhashcp.h needs POSIX.1-2008: define _POSIX_C_SOURCE to 200809L before including any header"
+#endif
+
+// sizeof cannot be used in #if; a negative array size is a compile-time error in both C99 and C++98.
+typedef char jjhashcp_needs_64_bit_off_t_define_FILE_OFFSET_BITS_to_64_[sizeof(off_t) >= 8 ? 1 : -1];
+
+#include "jjhashx.h"
+
+#ifndef JJHASHCP_ATTRS
+# define JJHASHCP_ATTRS inline
+#endif
+#ifndef JJHASHCP_BUF_SIZE
+# define JJHASHCP_BUF_SIZE 65536
+#endif
+
+#define JJHASHCP_MISMATCH (-1)
+
+// Reads exactly 'n' bytes at 'off' unless the file ends first; stores the number of bytes read into '*nread'.
+static JJHASHCP_ATTRS int jjhashcp_pread_(int fd, char *buf, size_t n, uint64_t off, size_t *nread)
+{
+    size_t done = 0;
+    *nread = 0;
+    while (done != n) {
+        ssize_t r = pread(fd, buf + done, n - done, (off_t) (off + done));
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        if (r == 0) {
+            break;
+        }
+        done += r;
+    }
+    *nread = done;
+    return 0;
+}
+
+// Feeds the bytes of the file from 'off' up to 'end' (or up to the end of the file, if 'end' is UINT64_MAX) into
+// 'st'; stores the offset it stopped at into '*stop'.
+static JJHASHCP_ATTRS int jjhashcp_feed_(int fd, struct jjhashx_stream *st, uint64_t off, uint64_t end, uint64_t *stop)
+{
+    char buf[JJHASHCP_BUF_SIZE];
+    for (;;) {
+        size_t n = end - off < sizeof(buf) ? (size_t) (end - off) : sizeof(buf);
+        if (n == 0) {
+            break;
+        }
+        size_t nread;
+        int err = jjhashcp_pread_(fd, buf, n, off, &nread);
+        if (err) {
+            return err;
+        }
+        jjhashx_stream_update(st, buf, nread);
+        off += nread;
+        if (nread != n) {
+            break;
+        }
+    }
+    *stop = off;
+    return 0;
+}
+
+// Checks that the file is at least 'length' bytes long and that its last 'length % 4' bytes are the pending bytes
+// of 'st'.
+static JJHASHCP_ATTRS int jjhashcp_check_tail(int fd, const struct jjhashx_stream *st, uint64_t length)
+{
+    char tail[4];
+    unsigned npending = st->npending;
+    // Read one more byte than needed, to see that the file is long enough even if there are no pending bytes.
+    uint64_t off = length - npending;
+    size_t n = npending;
+    if (off != 0) {
+        --off;
+        ++n;
+    }
+    size_t nread;
+    int err = jjhashcp_pread_(fd, tail, n, off, &nread);
+    if (err) {
+        return err;
+    }
+    if (nread != n) {
+        return JJHASHCP_MISMATCH;
+    }
+    const char *p = tail + (n - npending);
+    for (unsigned i = 0; i != npending; ++i) {
+        if ((uint8_t) p[i] != ((st->pending >> (8 * i)) & 0xff)) {
+            return JJHASHCP_MISMATCH;
+        }
+    }
+    return 0;
+}
+
+// Continues hashing the file from the checkpoint ('st' and 'length') to its end, updating both.
+static JJHASHCP_ATTRS int jjhashcp_resume(int fd, struct jjhashx_stream *st, uint64_t *length)
+{
+    int err = jjhashcp_check_tail(fd, st, *length);
+    if (err) {
+        return err;
+    }
+    return jjhashcp_feed_(fd, st, *length, UINT64_MAX, length);
+}
+
+// Checks that the first 'length' bytes of the file hash to the checkpoint 'st', by re-reading them.
+static JJHASHCP_ATTRS int jjhashcp_verify(int fd, const struct jjhashx_stream *st, uint64_t length)
+{
+    struct jjhashx_stream fresh;
+    jjhashx_stream_init(&fresh);
+    uint64_t stop;
+    int err = jjhashcp_feed_(fd, &fresh, 0, length, &stop);
+    if (err) {
+        return err;
+    }
+    if (stop != length
+            || fresh.state.the_state != st->state.the_state
+            || fresh.pending != st->pending
+            || fresh.npending != st->npending) {
+        return JJHASHCP_MISMATCH;
+    }
+    return 0;
+}
+
+// Fsyncs the directory containing 'path', so that a rename into it is durable.
+static JJHASHCP_ATTRS int jjhashcp_fsync_dir_(const char *path)
+{
+    char dir[4096];
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        strcpy(dir, ".");
+    } else {
+        size_t n = slash == path ? 1 : (size_t) (slash - path);
+        if (n >= sizeof(dir)) {
+            return ENAMETOOLONG;
+        }
+        memcpy(dir, path, n);
+        dir[n] = '\0';
+    }
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno;
+    }
+    int err = 0;
+    // Some file systems do not support fsync() on directories (EINVAL); there is nothing more we can do there.
+    if (fsync(fd) < 0 && errno != EINVAL) {
+        err = errno;
+    }
+    close(fd);
+    return err;
+}
+
+// Writes the checkpoint to 'path' atomically (through a temporary file named 'path' with ".tmp" appended, which is
+// then renamed), and durably (the file and then its directory are fsynced).
+static JJHASHCP_ATTRS int jjhashcp_save_file(const char *path, const struct jjhashx_stream *st, uint64_t length)
+{
+    unsigned char buf[JJHASHX_CHECKPOINT_SIZE];
+    jjhashx_checkpoint_save(st, length, buf);
+
+    char tmp_path[4096];
+    if ((size_t) snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= sizeof(tmp_path)) {
+        return ENAMETOOLONG;
+    }
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return errno;
+    }
+    ssize_t w;
+    do {
+        w = write(fd, buf, sizeof(buf));
+    } while (w < 0 && errno == EINTR);
+    int err = w < 0 ? errno : (w != (ssize_t) sizeof(buf) ? EIO : 0);
+    if (!err && fsync(fd) < 0) {
+        err = errno;
+    }
+    if (close(fd) < 0 && !err) {
+        err = errno;
+    }
+    if (!err && rename(tmp_path, path) < 0) {
+        err = errno;
+    }
+    if (err) {
+        unlink(tmp_path);
+        return err;
+    }
+    return jjhashcp_fsync_dir_(path);
+}
+
+// Reads a checkpoint written by jjhashcp_save_file(); returns JJHASHCP_MISMATCH if it is malformed or corrupted.
+static JJHASHCP_ATTRS int jjhashcp_load_file(const char *path, struct jjhashx_stream *st, uint64_t *length)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno;
+    }
+    char buf[JJHASHX_CHECKPOINT_SIZE + 1];
+    size_t nread;
+    int err = jjhashcp_pread_(fd, buf, sizeof(buf), 0, &nread);
+    close(fd);
+    if (err) {
+        return err;
+    }
+    if (nread != JJHASHX_CHECKPOINT_SIZE) {
+        return JJHASHCP_MISMATCH;
+    }
+    if (jjhashx_checkpoint_load((const unsigned char *) buf, st, length) != 0) {
+        return JJHASHCP_MISMATCH;
+    }
+    return 0;
+}
+
+#endif // JJHASHCP_INCLUDED__
@@ -0,0 +1,159 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHD_INCLUDED__
+#define JJHASHD_INCLUDED__
+
+// Runtime CPU dispatch for the kernels in jjhashv.h.
+//
+// jjhashd_b(), jjhashd_s() and jjhashd_b_many() call, through a table of function pointers, the
+// kernels picked for the CPU. The table starts out pointing to the portable kernels from jjhash.h;
+// on GNU C-compatible compilers, a constructor upgrades it at load time. Each translation unit
+// including this file gets its own table.
+//
+// jjhashd_b() is always the portable jjhash_b(). By default, the other two stay portable as well:
+// the SSE2 jjhashd_s() reads past the terminator (see below), and the AVX2 and AVX-512 batch kernels
+// gather the lanes word by word, and were measured to be no faster than jjhash_b_many() (slower on
+// ragged lengths; see bench/bench_many.c). The kernels are opt-in: set the JJHASH_KERNEL environment
+// variable to "sse2", "avx2" or "avx512" to use the kernels up to that set that the CPU supports
+// ("scalar" is the default). Any other value is reported on stderr (once per process) and ignored.
+// jjhashd_kernel_name() returns the name of the kernel set in use, so that it can be logged.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "jjhash.h"
+#include "jjhashv.h"
+
+#if defined(__GNUC__)
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+#endif
+
+#ifndef JJHASHD_ATTRS
+# define JJHASHD_ATTRS inline
+#endif
+
+struct jjhashd_table {
+    const char *name;
+    uint32_t (*b)(const char *s, size_t ns);
+    uint32_t (*s)(const char *s);
+    void (*b_many)(const char *const *ss, const size_t *nss, size_t n, uint32_t *out);
+};
+
+static struct jjhashd_table jjhashd_table_ = {
+    "scalar",
+    jjhash_b,
+    jjhash_s,
+    jjhash_b_many,
+};
+
+#if defined(__GNUC__) && JJHASHV_HAVE_SSE2
+
+# ifndef JJHASHD_KERNEL_WARNED_DEFINED__
+# define JJHASHD_KERNEL_WARNED_DEFINED__
+// Set once an unknown JJHASH_KERNEL value has been reported. It is weak, so that all the translation units
+// (and both jjhashd.h and jjhashd64.h) share it, and the value is reported once per process.
+__attribute__((weak)) int jjhashd_kernel_warned_;
+# endif
+
+// Returns the highest kernel set allowed by the JJHASH_KERNEL environment variable, as an index in
+// 'levels'. The default is "scalar": all the kernels are opt-in.
+static JJHASHD_ATTRS int jjhashd_max_level_(const char *const *levels, int nlevels)
+{
+    const char *cap = getenv("JJHASH_KERNEL");
+    if (!cap) {
+        return 0;
+    }
+    for (int i = 0; i < nlevels; ++i) {
+        if (strcmp(cap, levels[i]) == 0) {
+            return i;
+        }
+    }
+    if (!jjhashd_kernel_warned_) {
+        jjhashd_kernel_warned_ = 1;
+        fprintf(stderr, "jjhashd: ignoring unknown JJHASH_KERNEL value '%s' "
+                        "(expected scalar, sse2, avx2 or avx512)\n", cap);
+    }
+    return 0;
+}
+
+__attribute__((constructor))
+static void jjhashd_init_(void)
+{
+    static const char *const LEVELS[] = {"scalar", "sse2", "avx2", "avx512"};
+    enum { NLEVELS = sizeof(LEVELS) / sizeof(LEVELS[0]) };
+
+    int max_level = jjhashd_max_level_(LEVELS, NLEVELS);
+
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2") && max_level >= 1) {
+        jjhashd_table_.name = "sse2";
+        jjhashd_table_.s = jjhashv_s_sse2;
+    }
+# if JJHASHV_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2") && max_level >= 2) {
+        jjhashd_table_.name = "avx2";
+        jjhashd_table_.b_many = jjhashv_b_many_avx2;
+    }
+# endif
+# if JJHASHV_HAVE_AVX512
+    if (__builtin_cpu_supports("avx512f") && max_level >= 3) {
+        jjhashd_table_.name = "avx512";
+        jjhashd_table_.b_many = jjhashv_b_many_avx512;
+    }
+# endif
+}
+
+#endif
+
+static JJHASHD_ATTRS const char *jjhashd_kernel_name(void)
+{
+    return jjhashd_table_.name;
+}
+
+static JJHASHD_ATTRS uint32_t jjhashd_b(const char *s, size_t ns)
+{
+    return jjhashd_table_.b(s, ns);
+}
+
+// With JJHASH_KERNEL=sse2 (or higher), this is jjhashv_s_sse2(), which loads whole aligned 16-byte
+// blocks, and so reads up to 15 bytes past the terminator: never across a page boundary, but AddressSanitizer
+// and Valgrind report it.
+static JJHASHD_ATTRS uint32_t jjhashd_s(const char *s)
+{
+    return jjhashd_table_.s(s);
+}
+
+static JJHASHD_ATTRS void jjhashd_b_many(const char *const *ss, const size_t *nss, size_t n, uint32_t *out)
+{
+    jjhashd_table_.b_many(ss, nss, n, out);
+}
+
+#endif // JJHASHD_INCLUDED__
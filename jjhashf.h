@@ -0,0 +1,141 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHF_INCLUDED__
+#define JJHASHF_INCLUDED__
+
+// Hashing of fixed-size keys.
+//
+// jjhash_b_N(s) is the same as 'jjhash_b(s, N)', fully unrolled. The set of N's is configured
+// when generating this file (see templates/gen.sh).
+//
+// In C++, 'jjhash_b_n<N>(s)' is the same as 'jjhash_b(s, N)' for any N; it calls jjhash_b_N() if
+// it has been generated.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "jjhash.h"
+
+#ifndef JJHASHF_ATTRS
+# define JJHASHF_ATTRS inline
+#endif
+
+static JJHASHF_ATTRS uint32_t jjhash_b_8(const char *s)
+{
+    uint64_t a = JJHASH_ACCUM_INIT;
+
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 0));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 4));
+
+    JJHASH_ACCUM_FINALIZE(a);
+    // Truncations are implementation-defined, so let's do masking.
+    return a & UINT32_C(0xffffffff);
+}
+
+static JJHASHF_ATTRS uint32_t jjhash_b_16(const char *s)
+{
+    uint64_t a = JJHASH_ACCUM_INIT;
+
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 0));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 4));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 8));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 12));
+
+    JJHASH_ACCUM_FINALIZE(a);
+    // Truncations are implementation-defined, so let's do masking.
+    return a & UINT32_C(0xffffffff);
+}
+
+static JJHASHF_ATTRS uint32_t jjhash_b_20(const char *s)
+{
+    uint64_t a = JJHASH_ACCUM_INIT;
+
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 0));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 4));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 8));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 12));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 16));
+
+    JJHASH_ACCUM_FINALIZE(a);
+    // Truncations are implementation-defined, so let's do masking.
+    return a & UINT32_C(0xffffffff);
+}
+
+static JJHASHF_ATTRS uint32_t jjhash_b_32(const char *s)
+{
+    uint64_t a = JJHASH_ACCUM_INIT;
+
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 0));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 4));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 8));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 12));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 16));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 20));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 24));
+    JJHASH_ACCUM_FEED(a, JJHASH_FETCH_LE32(s + 28));
+
+    JJHASH_ACCUM_FINALIZE(a);
+    // Truncations are implementation-defined, so let's do masking.
+    return a & UINT32_C(0xffffffff);
+}
+
+#ifdef __cplusplus
+
+template<size_t N>
+inline uint32_t jjhash_b_n(const char *s)
+{
+    return jjhash_b(s, N);
+}
+
+template<>
+inline uint32_t jjhash_b_n<8>(const char *s)
+{
+    return jjhash_b_8(s);
+}
+
+template<>
+inline uint32_t jjhash_b_n<16>(const char *s)
+{
+    return jjhash_b_16(s);
+}
+
+template<>
+inline uint32_t jjhash_b_n<20>(const char *s)
+{
+    return jjhash_b_20(s);
+}
+
+template<>
+inline uint32_t jjhash_b_n<32>(const char *s)
+{
+    return jjhash_b_32(s);
+}
+
+#endif // __cplusplus
+
+#endif // JJHASHF_INCLUDED__
@@ -0,0 +1,93 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHL_INCLUDED__
+#define JJHASHL_INCLUDED__
+
+// Hashing for hash table lookups: the hash itself is cheap next to the cache miss on the bucket that follows it
+// when the table does not fit in the cache. jjhashl_b_prefetch() hashes a batch of keys and issues a prefetch
+// for the bucket of each of them as soon as its hash is known, so that the misses of the whole batch overlap;
+// the caller then probes the buckets (in the same order) after the batch call returns:
+//
+//     jjhashl_b_prefetch(ss, nss, n, table, sizeof(bucket), nbuckets - 1, hashes);
+//     for (size_t i = 0; i != n; ++i) {
+//         const bucket *b = (const bucket *) jjhashl_bucket(table, sizeof(bucket), nbuckets - 1, hashes[i]);
+//         ...
+//     }
+//
+// The bucket of hash 'h' is at 'base + (h & mask) * bucket_size'; only its first cache line is prefetched.
+// Batches of a few dozen keys work best: smaller ones leave fewer misses to overlap, and with larger ones the
+// first buckets may be evicted before they are probed.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "jjhash.h"
+
+#ifndef JJHASHL_ATTRS
+# define JJHASHL_ATTRS inline
+#endif
+
+// Prefetches the cache line containing 'p' for reading; define it before including this header to prefetch for
+// writing (e. g. for insertions) or with a different locality hint. A no-op on non-GNU compilers.
+#ifndef JJHASHL_PREFETCH
+# if defined(__GNUC__)
+#  define JJHASHL_PREFETCH(p) __builtin_prefetch((p), 0, 3)
+# else
+#  define JJHASHL_PREFETCH(p) ((void) (p))
+# endif
+#endif
+
+// Returns the address of the bucket of hash 'h'.
+static JJHASHL_ATTRS const void *jjhashl_bucket(const void *base, size_t bucket_size, size_t mask, uint32_t h)
+{
+    return (const char *) base + ((size_t) h & mask) * bucket_size;
+}
+
+// Calculates 'out[i] = jjhash_b(ss[i], nss[i])' for each 'i' in '0 ... n', and prefetches the bucket of
+// each 'out[i]'.
+static JJHASHL_ATTRS void jjhashl_b_prefetch(
+        const char *const *ss,
+        const size_t *nss,
+        size_t n,
+        const void *base,
+        size_t bucket_size,
+        size_t mask,
+        uint32_t *out)
+{
+    enum { L = JJHASH_MANY_LANES };
+
+    for (size_t i = 0; i < n; i += L) {
+        size_t m = n - i < (size_t) L ? n - i : (size_t) L;
+        jjhash_b_many(ss + i, nss + i, m, out + i);
+        for (size_t k = 0; k != m; ++k) {
+            JJHASHL_PREFETCH(jjhashl_bucket(base, bucket_size, mask, out[i + k]));
+        }
+    }
+}
+
+#endif // JJHASHL_INCLUDED__
@@ -0,0 +1,207 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHP_INCLUDED__
+#define JJHASHP_INCLUDED__
+
+// Hashing of hierarchical keys (file paths, "svc.region.host.cpu" metric names, object keys) with a cache
+// of the hashing states of their prefixes.
+//
+// Keys that share a long prefix with a recently hashed key only hash the part after the prefix. The cache is
+// direct-mapped and is keyed by the prefixes that end just before a separator (for '/' and the key "/a/b/c",
+// these are "/a" and "/a/b"; whole keys are not cached). The caller provides the memory for the entries:
+//
+// static struct jjhashp_entry entries[1024]; // must be a power of 2
+// struct jjhashp_cache cache;
+// jjhashp_init(&cache, entries, 1024, '/');
+// ...
+// hash = jjhashp_b(&cache, key, key_len); // same as jjhash_b(key, key_len)
+//
+// Prefixes longer than JJHASHP_MAX_PREFIX bytes (500 by default, so that an entry is 512 bytes) are not
+// cached; at most JJHASHP_MAX_DEPTH prefixes are looked up (and cached) per key, the longest ones first.
+//
+// Scanning for separators and comparing the cached prefix cost about as much as hashing the bytes they
+// save unless keys are long: on bench/bench_prefix.c, the cache was 2x slower than jjhash_b() on
+// 66-byte paths, and about as fast on 250-350-byte ones, but 1.4x faster on 450-byte paths. So keys
+// shorter than JJHASHP_MIN_LEN bytes are hashed with jjhash_b() right away, and neither looked up nor
+// cached. Keep JJHASHP_MAX_PREFIX at least as large, or the cache cannot save much on the keys it sees.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "jjhash.h"
+#include "jjhashx.h"
+
+#ifndef JJHASHP_ATTRS
+# define JJHASHP_ATTRS inline
+#endif
+#ifndef JJHASHP_MAX_PREFIX
+# define JJHASHP_MAX_PREFIX 500
+#endif
+#ifndef JJHASHP_MAX_DEPTH
+# define JJHASHP_MAX_DEPTH 32
+#endif
+#ifndef JJHASHP_MIN_LEN
+# define JJHASHP_MIN_LEN 256
+#endif
+
+struct jjhashp_entry {
+    // State of 'prefix', as jjhashx_b_begin() would return.
+    struct jjhashx_state state;
+    // Length of 'prefix'; 0 for an empty entry.
+    uint32_t len;
+    char prefix[JJHASHP_MAX_PREFIX];
+};
+
+struct jjhashp_stats {
+    // Number of keys hashed.
+    uint64_t keys;
+    // Number of keys that resumed from a cached prefix.
+    uint64_t hits;
+    // Number of keys shorter than JJHASHP_MIN_LEN, hashed without the cache.
+    uint64_t short_keys;
+    // Number of bytes hashed, and number of bytes skipped thanks to the cache.
+    uint64_t bytes_hashed;
+    uint64_t bytes_saved;
+};
+
+struct jjhashp_cache {
+    struct jjhashp_entry *entries;
+    size_t mask;
+    char sep;
+    struct jjhashp_stats stats;
+};
+
+// 'nentries' must be a power of 2.
+static JJHASHP_ATTRS void jjhashp_init(struct jjhashp_cache *cache, struct jjhashp_entry *entries, size_t nentries, char sep)
+{
+    for (size_t i = 0; i != nentries; ++i) {
+        entries[i].len = 0;
+    }
+    cache->entries = entries;
+    cache->mask = nentries - 1;
+    cache->sep = sep;
+    memset(&cache->stats, 0, sizeof(cache->stats));
+}
+
+// Picks the entry for the prefix s[0 ... n) from its length and its last (up to) 4 bytes, so that the
+// cache never has to hash a prefix to look it up.
+static JJHASHP_ATTRS struct jjhashp_entry *jjhashp_slot_(const struct jjhashp_cache *cache, const char *s, size_t n)
+{
+    uint32_t v = (uint32_t) n;
+    for (size_t i = n < 4 ? 0 : n - 4; i != n; ++i) {
+        v = (v << 8) ^ (uint8_t) s[i];
+    }
+    v *= UINT32_C(2654435761);
+    v ^= v >> 15;
+    return &cache->entries[v & cache->mask];
+}
+
+static JJHASHP_ATTRS void jjhashp_insert_(struct jjhashp_cache *cache, const char *s, size_t n, struct jjhashx_state state)
+{
+    struct jjhashp_entry *e = jjhashp_slot_(cache, s, n);
+    e->state = state;
+    e->len = (uint32_t) n;
+    memcpy(e->prefix, s, n);
+}
+
+// Returns the position of the last 'sep' in s[1 ... n), or 0 if there is none: reads 8 bytes at a time, and
+// checks them one by one only once one of them is 'sep' (so the byte order does not matter).
+static JJHASHP_ATTRS size_t jjhashp_rfind_(const char *s, size_t n, char sep)
+{
+    const uint64_t ones = UINT64_C(0x0101010101010101);
+    const uint64_t pattern = ones * (uint8_t) sep;
+    while (n >= 9) {
+        uint64_t w;
+        memcpy(&w, s + n - 8, 8);
+        w ^= pattern;
+        if ((w - ones) & ~w & (ones << 7)) {
+            break;
+        }
+        n -= 8;
+    }
+    while (n > 1) {
+        if (s[--n] == sep) {
+            return n;
+        }
+    }
+    return 0;
+}
+
+// Same as jjhash_b(s, ns).
+static JJHASHP_ATTRS uint32_t jjhashp_b(struct jjhashp_cache *cache, const char *s, size_t ns)
+{
+    if (ns < JJHASHP_MIN_LEN) {
+        ++cache->stats.keys;
+        ++cache->stats.short_keys;
+        cache->stats.bytes_hashed += ns;
+        return jjhash_b(s, ns);
+    }
+
+    // Look for the longest cached prefix, going back from the end of the key, so that a hit on a deep prefix
+    // only scans the last component. Remember the prefixes that missed, in decreasing order, to cache them.
+    size_t bounds[JJHASHP_MAX_DEPTH];
+    size_t nbounds = 0;
+    struct jjhashx_state state = {JJHASHX_ACCUM_INIT};
+    size_t done = 0;
+    size_t n = ns <= JJHASHP_MAX_PREFIX ? ns : JJHASHP_MAX_PREFIX + 1;
+    while (nbounds != JJHASHP_MAX_DEPTH && (n = jjhashp_rfind_(s, n, cache->sep)) != 0) {
+        const struct jjhashp_entry *e = jjhashp_slot_(cache, s, n);
+        if (e->len == n && memcmp(e->prefix, s, n) == 0) {
+            state = e->state;
+            done = n;
+            break;
+        }
+        bounds[nbounds++] = n;
+    }
+
+    ++cache->stats.keys;
+    if (done) {
+        ++cache->stats.hits;
+    }
+
+    // 'state' is the state of s[0 ... done); turn it into the state of s[0 ... aligned), where 'aligned' is a
+    // multiple of 4, so that we can continue from it. Then hash up to each of the remaining prefixes, caching them.
+    size_t aligned = JJHASHX_UNDO_TRUNCATE_TAIL(done);
+    state = jjhashx_undo(state, s + aligned, done - aligned);
+    cache->stats.bytes_saved += aligned;
+
+    while (nbounds != 0) {
+        n = bounds[--nbounds];
+        struct jjhashx_state prefix_state = jjhashx_b_continue(state, s + aligned, n - aligned);
+        cache->stats.bytes_hashed += n - aligned;
+        jjhashp_insert_(cache, s, n, prefix_state);
+        aligned = JJHASHX_UNDO_TRUNCATE_TAIL(n);
+        state = jjhashx_undo(prefix_state, s + aligned, n - aligned);
+    }
+
+    cache->stats.bytes_hashed += ns - aligned;
+    return jjhashx_finalize_state(jjhashx_b_continue(state, s + aligned, ns - aligned));
+}
+
+#endif // JJHASHP_INCLUDED__
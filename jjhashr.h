@@ -0,0 +1,349 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+#ifndef JJHASHR_INCLUDED__
+#define JJHASHR_INCLUDED__
+
+// Editable buffer (a flat rope: an array of chunks) that keeps the hashing state at each chunk boundary, so that
+// after an edit the hash of the whole buffer is recomputed from the chunk containing the first edited byte
+// onward rather than from the beginning:
+//
+// struct jjhashr_buf buf;
+// jjhashr_init(&buf, 4096);
+// jjhashr_insert(&buf, 0, text, text_len);
+// hash = jjhashr_hash(&buf, NULL); // hashes everything
+// jjhashr_insert(&buf, pos, "x", 1);
+// size_t nrehashed;
+// hash = jjhashr_hash(&buf, &nrehashed); // only hashes from the chunk containing 'pos'
+// ...
+// jjhashr_free(&buf);
+//
+// The hash is the same as jjhash_b() of the contents of the buffer. Since the hash is sequential, an edit
+// near the beginning still means rehashing almost everything; edits near the end are cheap. Several edits
+// between two calls to jjhashr_hash() cost one rehash.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jjhashx.h"
+
+#ifndef JJHASHR_ATTRS
+# define JJHASHR_ATTRS inline
+#endif
+
+struct jjhashr_chunk {
+    // 'chunk_size' bytes allocated, 'len' of them used.
+    char *data;
+    size_t len;
+    // Offset of the chunk in the buffer.
+    size_t off;
+    // State of the stream after this and all the previous chunks; only valid for chunks before 'first_dirty'.
+    struct jjhashx_stream end;
+};
+
+struct jjhashr_buf {
+    struct jjhashr_chunk *chunks;
+    size_t nchunks;
+    size_t chunks_capacity;
+    size_t chunk_size;
+    size_t len;
+    // Index of the first chunk whose contents or position changed since the last jjhashr_hash().
+    size_t first_dirty;
+};
+
+#define JJHASHR_MIN_CHUNK_SIZE 4
+
+// 'chunk_size' is the maximum number of bytes in a chunk, and also the maximum number of bytes that are
+// rehashed needlessly after an edit; 4096 is a good default. It must be at least JJHASHR_MIN_CHUNK_SIZE
+// (it need not be a multiple of 4): with 0, inserting would divide by zero.
+static JJHASHR_ATTRS void jjhashr_init(struct jjhashr_buf *buf, size_t chunk_size)
+{
+    assert(chunk_size >= JJHASHR_MIN_CHUNK_SIZE);
+
+    buf->chunks = NULL;
+    buf->nchunks = 0;
+    buf->chunks_capacity = 0;
+    buf->chunk_size = chunk_size;
+    buf->len = 0;
+    buf->first_dirty = 0;
+}
+
+static JJHASHR_ATTRS void jjhashr_free(struct jjhashr_buf *buf)
+{
+    for (size_t i = 0; i != buf->nchunks; ++i) {
+        free(buf->chunks[i].data);
+    }
+    free(buf->chunks);
+    jjhashr_init(buf, buf->chunk_size);
+}
+
+static JJHASHR_ATTRS size_t jjhashr_len(const struct jjhashr_buf *buf)
+{
+    return buf->len;
+}
+
+// Returns the index of the chunk containing the byte at 'pos' (or, for 'pos' equal to the length of the buffer,
+// the last chunk); 'pos' must not exceed the length of the buffer, which must not be empty.
+static JJHASHR_ATTRS size_t jjhashr_find_(const struct jjhashr_buf *buf, size_t pos)
+{
+    size_t lo = 0;
+    size_t hi = buf->nchunks;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (buf->chunks[mid].off <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static JJHASHR_ATTRS void jjhashr_update_offsets_(struct jjhashr_buf *buf, size_t i)
+{
+    size_t off = i ? buf->chunks[i - 1].off + buf->chunks[i - 1].len : 0;
+    for (; i != buf->nchunks; ++i) {
+        buf->chunks[i].off = off;
+        off += buf->chunks[i].len;
+    }
+    buf->len = off;
+}
+
+static JJHASHR_ATTRS void jjhashr_mark_dirty_(struct jjhashr_buf *buf, size_t i)
+{
+    if (buf->first_dirty > i) {
+        buf->first_dirty = i;
+    }
+}
+
+// Copies 'n' bytes at 'pos' to 'out'; 'pos + n' must not exceed the length of the buffer.
+static JJHASHR_ATTRS void jjhashr_read(const struct jjhashr_buf *buf, size_t pos, size_t n, char *out)
+{
+    if (n == 0) {
+        return;
+    }
+    size_t i = jjhashr_find_(buf, pos);
+    size_t o = pos - buf->chunks[i].off;
+    while (n) {
+        const struct jjhashr_chunk *c = &buf->chunks[i++];
+        size_t k = c->len - o < n ? c->len - o : n;
+        memcpy(out, c->data + o, k);
+        out += k;
+        n -= k;
+        o = 0;
+    }
+}
+
+// Inserts 'ns' bytes from 's' at 'pos', which must not exceed the length of the buffer.
+// Returns 0 on success, or -1 if out of memory, in which case the buffer is not changed.
+static JJHASHR_ATTRS int jjhashr_insert(struct jjhashr_buf *buf, size_t pos, const char *s, size_t ns)
+{
+    if (ns == 0) {
+        return 0;
+    }
+    size_t chunk_size = buf->chunk_size;
+
+    size_t i = 0;
+    size_t o = 0;
+    size_t old_len = 0;
+    if (buf->nchunks) {
+        i = jjhashr_find_(buf, pos);
+        o = pos - buf->chunks[i].off;
+        old_len = buf->chunks[i].len;
+        if (old_len + ns <= chunk_size) {
+            struct jjhashr_chunk *c = &buf->chunks[i];
+            memmove(c->data + o + ns, c->data + o, old_len - o);
+            memcpy(c->data + o, s, ns);
+            c->len += ns;
+            jjhashr_update_offsets_(buf, i + 1);
+            jjhashr_mark_dirty_(buf, i);
+            return 0;
+        }
+    }
+
+    // Spread the old contents of the chunk with the new bytes inserted evenly over 'm' chunks, so that the
+    // chunks have some room for further insertions. Allocate everything first, so that we can fail cleanly.
+    size_t total = old_len + ns;
+    size_t m = (total + chunk_size - 1) / chunk_size;
+    size_t nnew = buf->nchunks ? m - 1 : m;
+
+    if (buf->nchunks + nnew > buf->chunks_capacity) {
+        size_t capacity = buf->chunks_capacity * 2;
+        if (capacity < buf->nchunks + nnew) {
+            capacity = buf->nchunks + nnew;
+        }
+        struct jjhashr_chunk *chunks = (struct jjhashr_chunk *) realloc(buf->chunks, capacity * sizeof(*chunks));
+        if (!chunks) {
+            return -1;
+        }
+        buf->chunks = chunks;
+        buf->chunks_capacity = capacity;
+    }
+
+    char *tail = (char *) malloc(old_len - o + 1);
+    char **blocks = (char **) malloc((nnew + 1) * sizeof(char *));
+    size_t nblocks = 0;
+    if (tail && blocks) {
+        for (; nblocks != nnew; ++nblocks) {
+            blocks[nblocks] = (char *) malloc(chunk_size);
+            if (!blocks[nblocks]) {
+                break;
+            }
+        }
+    }
+    if (!tail || !blocks || nblocks != nnew) {
+        for (size_t k = 0; k != nblocks; ++k) {
+            free(blocks[k]);
+        }
+        free(blocks);
+        free(tail);
+        return -1;
+    }
+
+    // From now on, nothing can fail.
+    struct jjhashr_chunk *chunks = buf->chunks;
+    size_t first_new = buf->nchunks ? i + 1 : 0;
+    memmove(chunks + first_new + nnew, chunks + first_new, (buf->nchunks - first_new) * sizeof(*chunks));
+    for (size_t k = 0; k != nnew; ++k) {
+        chunks[first_new + k].data = blocks[k];
+        chunks[first_new + k].len = 0;
+    }
+    free(blocks);
+    buf->nchunks += nnew;
+
+    // Chunk 'i' keeps its first 'o' bytes; then the new bytes and the old tail are written from there on.
+    if (old_len) {
+        memcpy(tail, chunks[i].data + o, old_len - o);
+    }
+    chunks[i].len = o;
+    const char *pieces[2] = {s, tail};
+    size_t npieces[2] = {ns, old_len - o};
+    size_t per_chunk = (total + m - 1) / m;
+    // Chunk 'i' may already hold more than that; the rest still fits, as 'total' is at most 'm * per_chunk'.
+    size_t cap_i = o > per_chunk ? o : per_chunk;
+    size_t dst = i;
+    for (int p = 0; p != 2; ++p) {
+        const char *src = pieces[p];
+        size_t nsrc = npieces[p];
+        while (nsrc) {
+            struct jjhashr_chunk *c = &chunks[dst];
+            size_t cap = dst == i ? cap_i : per_chunk;
+            if (c->len == cap) {
+                c = &chunks[++dst];
+                cap = per_chunk;
+            }
+            size_t k = cap - c->len < nsrc ? cap - c->len : nsrc;
+            memcpy(c->data + c->len, src, k);
+            c->len += k;
+            src += k;
+            nsrc -= k;
+        }
+    }
+    free(tail);
+
+    jjhashr_update_offsets_(buf, i);
+    jjhashr_mark_dirty_(buf, i);
+    return 0;
+}
+
+// Removes 'n' bytes at 'pos'; 'pos + n' must not exceed the length of the buffer.
+static JJHASHR_ATTRS void jjhashr_erase(struct jjhashr_buf *buf, size_t pos, size_t n)
+{
+    if (n == 0) {
+        return;
+    }
+    size_t first = jjhashr_find_(buf, pos);
+    size_t o = pos - buf->chunks[first].off;
+
+    // Cut the bytes out of each of the chunks, then drop the chunks that became empty.
+    size_t i = first;
+    for (size_t left = n; left; ++i, o = 0) {
+        struct jjhashr_chunk *c = &buf->chunks[i];
+        size_t k = c->len - o < left ? c->len - o : left;
+        memmove(c->data + o, c->data + o + k, c->len - o - k);
+        c->len -= k;
+        left -= k;
+    }
+
+    size_t out = first;
+    for (size_t in = first; in != buf->nchunks; ++in) {
+        if (buf->chunks[in].len == 0) {
+            free(buf->chunks[in].data);
+        } else {
+            buf->chunks[out++] = buf->chunks[in];
+        }
+    }
+    buf->nchunks = out;
+
+    // Merge the first edited chunk with the next one if they are small, so that repeated erasures do not
+    // leave many tiny chunks behind.
+    if (first + 1 < buf->nchunks && buf->chunks[first].len + buf->chunks[first + 1].len <= buf->chunk_size / 2) {
+        struct jjhashr_chunk *c = &buf->chunks[first];
+        memcpy(c->data + c->len, c[1].data, c[1].len);
+        c->len += c[1].len;
+        free(c[1].data);
+        memmove(c + 1, c + 2, (buf->nchunks - first - 2) * sizeof(*c));
+        --buf->nchunks;
+    }
+
+    jjhashr_update_offsets_(buf, first);
+    jjhashr_mark_dirty_(buf, first);
+}
+
+// Returns the hash of the contents of the buffer, same as jjhash_b() of them. Only the chunks starting from
+// the first one changed since the previous call are hashed; if 'nrehashed' is not NULL, the number of bytes
+// hashed is stored there.
+static JJHASHR_ATTRS uint32_t jjhashr_hash(struct jjhashr_buf *buf, size_t *nrehashed)
+{
+    size_t i = buf->first_dirty < buf->nchunks ? buf->first_dirty : buf->nchunks;
+
+    struct jjhashx_stream st;
+    if (i) {
+        st = buf->chunks[i - 1].end;
+    } else {
+        jjhashx_stream_init(&st);
+    }
+
+    size_t n = 0;
+    for (; i != buf->nchunks; ++i) {
+        struct jjhashr_chunk *c = &buf->chunks[i];
+        jjhashx_stream_update(&st, c->data, c->len);
+        c->end = st;
+        n += c->len;
+    }
+    buf->first_dirty = buf->nchunks;
+
+    if (nrehashed) {
+        *nrehashed = n;
+    }
+    return jjhashx_stream_final(&st);
+}
+
+#endif // JJHASHR_INCLUDED__
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+
+set -e
+
+# Compares the throughput of jjsum (both back ends) with 'cat > /dev/null' on the files under a directory.
+# If no directory is given, a corpus of 64 files of 16 MiB is generated in a temporary directory.
+# With DROP_CACHES=1 (requires root), the page cache is dropped before each run, so that the storage is measured
+# rather than the memory.
+
+dir=$1
+
+if [[ -z $dir ]]; then
+    dir=$(mktemp -d)
+    trap 'rm -rf "$dir"' EXIT
+    for (( i = 0; i < 64; ++i )); do
+        head -c $(( 16 << 20 )) /dev/urandom > "$dir/file$i"
+    done
+fi
+
+${CC:-gcc} -Wall -Wextra -O3 -march=native -pthread jjsum.c ../utils/common.c -o jjsum
+
+nbytes=$(find "$dir" -type f -printf '%s\n' | awk '{ n += $1 } END { print n + 0 }')
+
+run() {
+    local name=$1; shift
+    if [[ $DROP_CACHES == 1 ]]; then
+        sync
+        echo 3 > /proc/sys/vm/drop_caches
+    else
+        # Warm up the page cache.
+        "$@" > /dev/null
+    fi
+    local t0 t1
+    t0=$(date +%s.%N)
+    "$@" > /dev/null
+    t1=$(date +%s.%N)
+    awk -v"name=$name" -v"n=$nbytes" -v"t0=$t0" -v"t1=$t1" \
+        'BEGIN { printf("%-12s %8.3f s %8.3f GB/s\n", name, t1 - t0, n / (t1 - t0) / 1e9); exit }'
+}
+
+run_cat() {
+    find "$dir" -type f -exec cat {} + > /dev/null
+}
+
+echo "$nbytes bytes"
+run cat run_cat
+run jjsum-mmap ./jjsum -b mmap "$dir"
+run jjsum-uring ./jjsum -b uring "$dir"
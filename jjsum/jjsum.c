@@ -0,0 +1,642 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+// jjsum: prints jjhash64 of files, like sha256sum, but recursing into directories and hashing many files at once.
+//
+// Files are hashed by a pool of threads, with one of two I/O back ends:
+//   * mmap: the file is mapped in windows of MMAP_WINDOW bytes, with MADV_SEQUENTIAL;
+//   * uring: each thread has an io_uring with URING_DEPTH registered buffers of URING_BLOCK bytes, and keeps
+//     that many reads of the file in flight (Linux 5.1 or later).
+// The output is sorted by path, so it does not depend on the number of threads or on the back end.
+
+#include "../utils/common.h"
+
+#include "../jjhash_64/jjhashx64.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <setjmp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+enum { MMAP_WINDOW = 64 << 20 };
+
+enum { URING_DEPTH = 8 };
+enum { URING_BLOCK = 512 << 10 };
+
+typedef enum {
+    BACKEND_MMAP,
+    BACKEND_URING,
+} Backend;
+
+typedef struct {
+    char *path;
+    uint64_t hash;
+    // 0, or errno of the failure.
+    int err;
+} Entry;
+
+typedef struct {
+    Entry *data;
+    size_t size;
+    size_t capacity;
+} Entries;
+
+static Entries entries;
+static size_t next_entry;
+static Backend backend = BACKEND_MMAP;
+static bool walk_failed = false;
+
+//-----------------------------------------------
+// Collecting the files
+
+static void entries_add(char *path)
+{
+    if (entries.size == entries.capacity) {
+        entries.data = x2realloc_or_die(entries.data, &entries.capacity, sizeof(Entry));
+    }
+    entries.data[entries.size++] = (Entry) {.path = path};
+}
+
+static void walk_error(const char *path)
+{
+    fprintf(stderr, "jjsum: %s: %s\n", path, strerror(errno));
+    walk_failed = true;
+}
+
+// Adds the regular files under 'path'. Symbolic links are followed only if given on the command line,
+// like 'find -H'. Takes ownership of 'path'.
+static void walk(char *path, bool top)
+{
+    struct stat st;
+    if ((top ? stat(path, &st) : lstat(path, &st)) < 0) {
+        walk_error(path);
+        free(path);
+        return;
+    }
+
+    if (S_ISREG(st.st_mode)) {
+        entries_add(path);
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        free(path);
+        return;
+    }
+
+    DIR *d = opendir(path);
+    if (!d) {
+        walk_error(path);
+        free(path);
+        return;
+    }
+    size_t npath = strlen(path);
+    const char *sep = (npath && path[npath - 1] == '/') ? "" : "/";
+    struct dirent *de;
+    while ((errno = 0, de = readdir(d))) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+        walk(allocf_or_die("%s%s%s", path, sep, de->d_name), false);
+    }
+    if (errno) {
+        walk_error(path);
+    }
+    closedir(d);
+    free(path);
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    return strcmp(((const Entry *) a)->path, ((const Entry *) b)->path);
+}
+
+//-----------------------------------------------
+// mmap back end
+
+// Where the SIGBUS handler jumps to, while this thread is hashing a mapped window.
+static __thread sigjmp_buf *sigbus_jmp;
+
+// Accessing a mapping past the end of the file raises SIGBUS; this happens when a file is truncated
+// while it is being hashed.
+static void on_sigbus(int sig)
+{
+    if (sigbus_jmp) {
+        siglongjmp(*sigbus_jmp, 1);
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// Hashes the file from 'off' (a multiple of 4) on with pread(), 'state' being the state of the bytes before it.
+static int hash_fd_pread(int fd, uint64_t off, struct jjhashx64_state state, uint64_t *out)
+{
+    struct jjhashx64_stream stream = {.state = state, .pending = 0, .npending = 0};
+    char *buf = malloc_or_die(1, URING_BLOCK);
+    int err = 0;
+    for (;;) {
+        ssize_t r = pread(fd, buf, URING_BLOCK, off);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            err = errno;
+            break;
+        }
+        if (r == 0) {
+            break;
+        }
+        jjhashx64_stream_update(&stream, buf, r);
+        off += r;
+    }
+    free(buf);
+
+    if (err) {
+        return err;
+    }
+    *out = jjhashx64_stream_final(&stream);
+    return 0;
+}
+
+// Not inlined, so that none of its variables live across sigsetjmp() in hash_window().
+static __attribute__((noinline)) void feed_window(const char *p, size_t n, struct jjhashx64_state *state)
+{
+    *state = jjhashx64_b_continue(*state, p, n);
+}
+
+// Feeds a mapped window to 'state'; returns false if the file was truncated under it (and leaves 'state' as is).
+static bool hash_window(const char *p, size_t n, struct jjhashx64_state *state)
+{
+    sigjmp_buf jmp;
+    if (sigsetjmp(jmp, 1)) {
+        sigbus_jmp = NULL;
+        return false;
+    }
+    sigbus_jmp = &jmp;
+    feed_window(p, n, state);
+    sigbus_jmp = NULL;
+    return true;
+}
+
+static int hash_fd_mmap(int fd, uint64_t *out)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return errno;
+    }
+    uint64_t size = st.st_size;
+
+    // MMAP_WINDOW is a multiple of both the page size and 4, so the windows can be fed to _b_continue() one by one.
+    struct jjhashx64_state state = jjhashx64_b_begin("", 0);
+    for (uint64_t off = 0; off < size; off += MMAP_WINDOW) {
+        size_t n = size - off < MMAP_WINDOW ? size - off : MMAP_WINDOW;
+        char *p = mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, off);
+        if (p == MAP_FAILED) {
+            return errno;
+        }
+        madvise(p, n, MADV_SEQUENTIAL);
+
+        // If the file shrinks under us, hash the window (and whatever follows it) again with pread(), so
+        // that, like with the io_uring back end and 'cat', we hash what is left.
+        bool ok = hash_window(p, n, &state);
+        munmap(p, n);
+        if (!ok) {
+            return hash_fd_pread(fd, off, state, out);
+        }
+    }
+
+    *out = jjhashx64_finalize_state(state);
+    return 0;
+}
+
+//-----------------------------------------------
+// io_uring back end (raw system calls, as liburing is not always available)
+
+typedef struct {
+    int fd;
+
+    void *sq_ring;
+    size_t sq_ring_len;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned to_submit;
+
+    void *cq_ring;
+    size_t cq_ring_len;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    // URING_DEPTH buffers of URING_BLOCK bytes, registered with the ring.
+    char *bufs;
+} Uring;
+
+typedef struct {
+    uint64_t off;
+    size_t len;
+    size_t filled;
+    bool done;
+} Slot;
+
+static int uring_init(Uring *R)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    R->fd = syscall(__NR_io_uring_setup, URING_DEPTH, &p);
+    if (R->fd < 0) {
+        return errno;
+    }
+    R->sq_ring = MAP_FAILED;
+    R->cq_ring = MAP_FAILED;
+    R->sqes = MAP_FAILED;
+    R->bufs = NULL;
+
+    R->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    R->cq_ring_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        if (R->sq_ring_len < R->cq_ring_len) {
+            R->sq_ring_len = R->cq_ring_len;
+        }
+        R->cq_ring_len = 0;
+    }
+
+    R->sq_ring = mmap(NULL, R->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, R->fd, IORING_OFF_SQ_RING);
+    if (R->sq_ring == MAP_FAILED) {
+        goto fail;
+    }
+    if (single_mmap) {
+        R->cq_ring = R->sq_ring;
+    } else {
+        R->cq_ring = mmap(NULL, R->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, R->fd, IORING_OFF_CQ_RING);
+        if (R->cq_ring == MAP_FAILED) {
+            goto fail;
+        }
+    }
+    R->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    R->sqes = mmap(NULL, R->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, R->fd, IORING_OFF_SQES);
+    if (R->sqes == MAP_FAILED) {
+        goto fail;
+    }
+
+    char *sq = R->sq_ring;
+    R->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    R->sq_mask = *(unsigned *) (sq + p.sq_off.ring_mask);
+    R->sq_array = (unsigned *) (sq + p.sq_off.array);
+    R->to_submit = 0;
+
+    char *cq = R->cq_ring;
+    R->cq_head = (unsigned *) (cq + p.cq_off.head);
+    R->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    R->cq_mask = *(unsigned *) (cq + p.cq_off.ring_mask);
+    R->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+    R->bufs = malloc_or_die(URING_DEPTH, URING_BLOCK);
+    struct iovec iov[URING_DEPTH];
+    for (int i = 0; i < URING_DEPTH; ++i) {
+        iov[i] = (struct iovec) {.iov_base = R->bufs + (size_t) i * URING_BLOCK, .iov_len = URING_BLOCK};
+    }
+    if (syscall(__NR_io_uring_register, R->fd, IORING_REGISTER_BUFFERS, iov, URING_DEPTH) < 0) {
+        goto fail;
+    }
+    return 0;
+
+fail:
+    ;
+    int err = errno;
+    free(R->bufs);
+    if (R->sqes != MAP_FAILED) {
+        munmap(R->sqes, R->sqes_len);
+    }
+    if (R->cq_ring != MAP_FAILED && R->cq_ring != R->sq_ring) {
+        munmap(R->cq_ring, R->cq_ring_len);
+    }
+    if (R->sq_ring != MAP_FAILED) {
+        munmap(R->sq_ring, R->sq_ring_len);
+    }
+    close(R->fd);
+    return err;
+}
+
+static void uring_free(Uring *R)
+{
+    munmap(R->sqes, R->sqes_len);
+    if (R->cq_ring != R->sq_ring) {
+        munmap(R->cq_ring, R->cq_ring_len);
+    }
+    munmap(R->sq_ring, R->sq_ring_len);
+    close(R->fd);
+    free(R->bufs);
+}
+
+static void uring_push_read(Uring *R, int fd, unsigned slot, size_t buf_off, size_t len, uint64_t off)
+{
+    // We are the only producer, so a plain load of the tail is fine.
+    unsigned tail = *R->sq_tail;
+    unsigned idx = tail & R->sq_mask;
+    struct io_uring_sqe *sqe = &R->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t) (R->bufs + (size_t) slot * URING_BLOCK + buf_off);
+    sqe->len = len;
+    sqe->off = off;
+    sqe->buf_index = slot;
+    sqe->user_data = slot;
+    R->sq_array[idx] = idx;
+    __atomic_store_n(R->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++R->to_submit;
+}
+
+// Submits the pending reads and waits for at least one completion.
+static int uring_submit_and_wait(Uring *R)
+{
+    for (;;) {
+        long r = syscall(__NR_io_uring_enter, R->fd, R->to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (r >= 0) {
+            R->to_submit -= r;
+            return 0;
+        }
+        if (errno != EINTR) {
+            return errno;
+        }
+    }
+}
+
+static void slot_submit(Uring *R, int fd, Slot *slots, uint64_t block, uint64_t size)
+{
+    unsigned k = block % URING_DEPTH;
+    uint64_t off = block * URING_BLOCK;
+    slots[k] = (Slot) {
+        .off = off,
+        .len = size - off < URING_BLOCK ? size - off : URING_BLOCK,
+        .filled = 0,
+        .done = false,
+    };
+    uring_push_read(R, fd, k, 0, slots[k].len, off);
+}
+
+// Processes the completions; short reads are resubmitted for the rest of the block.
+static int uring_reap(Uring *R, int fd, Slot *slots, unsigned *inflight)
+{
+    int err = 0;
+    unsigned head = *R->cq_head;
+    unsigned tail = __atomic_load_n(R->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe *cqe = &R->cqes[head & R->cq_mask];
+        Slot *s = &slots[cqe->user_data];
+        int res = cqe->res;
+        if (res < 0) {
+            err = -res;
+            s->done = true;
+            --*inflight;
+        } else if (res == 0 || s->filled + res == s->len) {
+            // res == 0 means the file was truncated while we were reading it; hash what we got, like 'cat' would.
+            s->filled += res;
+            s->done = true;
+            --*inflight;
+        } else {
+            s->filled += res;
+            uring_push_read(R, fd, cqe->user_data, s->filled, s->len - s->filled, s->off + s->filled);
+        }
+    }
+    __atomic_store_n(R->cq_head, head, __ATOMIC_RELEASE);
+    return err;
+}
+
+static int hash_fd_uring(Uring *R, int fd, uint64_t *out)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return errno;
+    }
+    uint64_t size = st.st_size;
+    uint64_t nblocks = (size + URING_BLOCK - 1) / URING_BLOCK;
+
+    Slot slots[URING_DEPTH];
+    unsigned inflight = 0;
+    uint64_t next_submit = 0;
+    for (; next_submit < nblocks && inflight < URING_DEPTH; ++next_submit, ++inflight) {
+        slot_submit(R, fd, slots, next_submit, size);
+    }
+
+    // Blocks complete in any order, but are hashed in order, through a stream, as short reads may leave a block
+    // that is not a multiple of 4 bytes long.
+    struct jjhashx64_stream stream;
+    jjhashx64_stream_init(&stream);
+    int err = 0;
+    bool truncated = false;
+    for (uint64_t block = 0; block < nblocks && !err && !truncated; ++block) {
+        Slot *s = &slots[block % URING_DEPTH];
+        while (!s->done && !err) {
+            err = uring_submit_and_wait(R);
+            if (!err) {
+                err = uring_reap(R, fd, slots, &inflight);
+            }
+        }
+        if (err) {
+            break;
+        }
+        jjhashx64_stream_update(&stream, R->bufs + (block % URING_DEPTH) * (size_t) URING_BLOCK, s->filled);
+        truncated = s->filled != s->len;
+        if (next_submit < nblocks && !truncated) {
+            slot_submit(R, fd, slots, next_submit++, size);
+            ++inflight;
+        }
+    }
+
+    // The buffers must not be reused while the kernel may still write into them.
+    while (inflight) {
+        if (uring_submit_and_wait(R) != 0) {
+            fputs("jjsum: io_uring_enter() failed with reads in flight\n", stderr);
+            abort();
+        }
+        uring_reap(R, fd, slots, &inflight);
+    }
+
+    if (err) {
+        return err;
+    }
+    *out = jjhashx64_stream_final(&stream);
+    return 0;
+}
+
+//-----------------------------------------------
+// Thread pool
+
+static void *worker(void *arg)
+{
+    (void) arg;
+
+    Uring R;
+    if (backend == BACKEND_URING) {
+        int err = uring_init(&R);
+        if (err) {
+            fprintf(stderr, "jjsum: cannot set up io_uring: %s\n", strerror(err));
+            exit(2);
+        }
+    }
+
+    for (;;) {
+        size_t i = __atomic_fetch_add(&next_entry, 1, __ATOMIC_RELAXED);
+        if (i >= entries.size) {
+            break;
+        }
+        Entry *e = &entries.data[i];
+        int fd = open(e->path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            e->err = errno;
+            continue;
+        }
+        e->err = backend == BACKEND_URING ? hash_fd_uring(&R, fd, &e->hash) : hash_fd_mmap(fd, &e->hash);
+        close(fd);
+    }
+
+    if (backend == BACKEND_URING) {
+        uring_free(&R);
+    }
+    return NULL;
+}
+
+//-----------------------------------------------
+
+// Prints the line for a file like sha256sum: if the name contains a backslash, a newline or a carriage return,
+// these are escaped (as \\, \n and \r), and the line starts with a backslash, so that it can still be parsed.
+static void print_entry(uint64_t hash, const char *path)
+{
+    bool escape = strpbrk(path, "\\\n\r") != NULL;
+    printf("%s%016" PRIx64 "  ", escape ? "\\" : "", hash);
+    if (!escape) {
+        fputs(path, stdout);
+    } else {
+        for (const char *c = path; *c; ++c) {
+            switch (*c) {
+            case '\\':
+                fputs("\\\\", stdout);
+                break;
+            case '\n':
+                fputs("\\n", stdout);
+                break;
+            case '\r':
+                fputs("\\r", stdout);
+                break;
+            default:
+                putchar(*c);
+            }
+        }
+    }
+    putchar('\n');
+}
+
+static void usage(void)
+{
+    fputs("USAGE: jjsum [-b mmap|uring] [-j THREADS] FILE_OR_DIRECTORY...\n", stderr);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    int c;
+    while ((c = getopt(argc, argv, "b:j:")) != -1) {
+        switch (c) {
+        case 'b':
+            if (strcmp(optarg, "mmap") == 0) {
+                backend = BACKEND_MMAP;
+            } else if (strcmp(optarg, "uring") == 0) {
+                backend = BACKEND_URING;
+            } else {
+                usage();
+            }
+            break;
+        case 'j':
+            nthreads = strtol(optarg, NULL, 10);
+            if (nthreads <= 0) {
+                usage();
+            }
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind == argc) {
+        usage();
+    }
+    if (nthreads <= 0) {
+        nthreads = 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigbus;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGBUS, &sa, NULL);
+
+    for (int i = optind; i < argc; ++i) {
+        walk(strdup_or_die(argv[i]), true);
+    }
+    qsort(entries.data, entries.size, sizeof(Entry), compare_entries);
+
+    if ((size_t) nthreads > entries.size) {
+        nthreads = entries.size ? entries.size : 1;
+    }
+    pthread_t *threads = malloc_or_die(nthreads, sizeof(pthread_t));
+    for (long i = 0; i < nthreads; ++i) {
+        int err = pthread_create(&threads[i], NULL, worker, NULL);
+        if (err) {
+            fprintf(stderr, "jjsum: pthread_create: %s\n", strerror(err));
+            return 2;
+        }
+    }
+    for (long i = 0; i < nthreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    bool failed = walk_failed;
+    for (size_t i = 0; i < entries.size; ++i) {
+        const Entry *e = &entries.data[i];
+        if (e->err) {
+            fprintf(stderr, "jjsum: %s: %s\n", e->path, strerror(e->err));
+            failed = true;
+        } else {
+            print_entry(e->hash, e->path);
+        }
+        free(e->path);
+    }
+    free(entries.data);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+
+set -e
+
+# Compares the throughput of jjuniq with 'sort -u' on NLINES lines (by default, 20 million) drawn from NWORDS distinct
+# ones (by default, 2 million), and checks that they print the same set of lines.
+# Extra arguments are passed to the compiler; e.g. -DJJUNIQ_HASH_BITS=12 makes most of the distinct lines collide,
+# to test the handling of collisions (use a smaller NWORDS then, as the hash tables degrade), and
+# -DJJUNIQ_MIN_TABLE_BUDGET=4096 makes the spilled partitions be split again.
+
+nlines=${NLINES:-20000000}
+nwords=${NWORDS:-2000000}
+
+${CC:-gcc} -Wall -Wextra -O3 -march=native -pthread jjuniq.c ../utils/common.c "$@" -o jjuniq
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+awk -v"nlines=$nlines" -v"nwords=$nwords" 'BEGIN {
+    srand(1);
+    for (i = 0; i < nlines; ++i) {
+        w = int(rand() * nwords);
+        printf("/var/log/service-%d/host-%d.example.com/%d\n", w % 97, w, w * 7919 % 1000003);
+    }
+}' > "$dir/input"
+
+echo "$(wc -c < "$dir/input") bytes, $nlines lines"
+
+run() {
+    local name=$1; shift
+    local t0 t1
+    t0=$(date +%s.%N)
+    "$@" > "$dir/out_$name"
+    t1=$(date +%s.%N)
+    awk -v"name=$name" -v"t0=$t0" -v"t1=$t1" 'BEGIN { printf("%-16s %8.3f s\n", name, t1 - t0); exit }'
+}
+
+run sort-u env LC_ALL=C sort -u "$dir/input"
+run jjuniq ./jjuniq "$dir/input"
+run jjuniq-spill ./jjuniq -m 0 "$dir/input"
+run jjuniq-pipe sh -c 'cat "$1" | ./jjuniq -m 0' sh "$dir/input"
+
+for out in jjuniq jjuniq-spill jjuniq-pipe; do
+    if ! LC_ALL=C sort "$dir/out_$out" | cmp -s - "$dir/out_sort-u"; then
+        echo >&2 "$out: output differs from 'sort -u'!"
+        exit 1
+    fi
+done
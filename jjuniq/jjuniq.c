@@ -0,0 +1,665 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+// jjuniq: prints the distinct lines of a file (or counts them, with -c), like 'sort | uniq [-c]', but without sorting.
+//
+// The input is mapped into memory and split between threads at line boundaries. Each thread finds the lines with
+// memchr() (which glibc vectorizes), hashes them with jjhash64_b, and sorts them into NPARTITIONS partitions by the
+// upper bits of the hash. Then each partition is deduplicated with a hash table, comparing the lines themselves on
+// equal hashes, so collisions do not merge different lines.
+//
+// The standard input is copied to a temporary file first (unless it is a regular file), and mapped likewise.
+//
+// If the records of the lines and the hash tables would not fit in the memory budget (-m), the partitions are spilled
+// to temporary files and processed one by one per thread, streaming the records into a hash table; a partition whose
+// distinct lines do not fit in the thread's share of the budget is split again, into NSUBPARTITIONS files, by the
+// next bits of the hashes. So the memory used does not grow with the input (apart from the page cache).
+//
+// The output is ordered by partition (and by sub-partition, for the partitions that had to be split again), then by
+// first occurrence; it does not depend on the number of threads, but it is not sorted.
+
+#include "../utils/common.h"
+
+#include "../jjhash_64/jjhash64.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// For testing the handling of collisions: keep only this many upper bits of the hashes.
+#ifndef JJUNIQ_HASH_BITS
+#define JJUNIQ_HASH_BITS 64
+#endif
+
+enum { PARTITION_BITS = 8 };
+enum { NPARTITIONS = 1 << PARTITION_BITS };
+
+// Number of records a thread buffers per partition before writing them to the partition's file.
+enum { SPILL_BUF = 256 };
+
+// Number of records read from a temporary file at a time.
+enum { READ_CHUNK = 4096 };
+
+// A spilled partition whose distinct lines do not fit in the table budget is split into this many files; fewer than
+// NPARTITIONS, so that nested splits do not open too many files.
+enum { SUBPARTITION_BITS = 4 };
+enum { NSUBPARTITIONS = 1 << SUBPARTITION_BITS };
+
+// Smallest table budget (in bytes), so that tiny budgets (e.g. -m 0, to force spilling) do not split partitions over
+// and over. For testing the splitting, make it smaller.
+#ifndef JJUNIQ_MIN_TABLE_BUDGET
+#define JJUNIQ_MIN_TABLE_BUDGET (1 << 20)
+#endif
+
+typedef struct {
+    uint64_t hash;
+    uint64_t off;
+    uint64_t len;
+} Record;
+
+typedef struct {
+    Record *data;
+    size_t size;
+    size_t capacity;
+} Records;
+
+typedef struct {
+    uint64_t hash;
+    uint64_t off;
+    uint64_t len;
+    // 0 for an empty slot.
+    uint64_t count;
+} Distinct;
+
+static const char *input;
+static size_t input_size;
+
+static int nthreads;
+static bool print_counts = false;
+static bool spill = false;
+// Spilling: the largest hash table (in bytes) each thread builds before splitting a partition again.
+static size_t table_budget;
+
+// Not spilling: records[thread][partition].
+static Records (*records)[NPARTITIONS];
+
+// Spilling: one file per partition.
+static FILE *spill_files[NPARTITIONS];
+static pthread_mutex_t spill_mutexes[NPARTITIONS];
+
+static size_t next_partition;
+static size_t next_to_print;
+static pthread_mutex_t print_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t print_cond = PTHREAD_COND_INITIALIZER;
+
+static void die_errno(const char *what)
+{
+    fprintf(stderr, "jjuniq: %s: %s\n", what, strerror(errno));
+    exit(2);
+}
+
+static FILE *tmpfile_or_die(void)
+{
+    FILE *f = tmpfile();
+    if (!f) {
+        die_errno("creating temporary file");
+    }
+    return f;
+}
+
+static void rewind_or_die(FILE *f)
+{
+    if (fseek(f, 0, SEEK_SET) != 0) {
+        die_errno("seeking temporary file");
+    }
+}
+
+static void fwrite_or_die(const void *p, size_t size, size_t n, FILE *f)
+{
+    if (fwrite(p, size, n, f) != n) {
+        die_errno("writing temporary file");
+    }
+}
+
+// Like fread(), but dies on errors.
+static size_t fread_or_die(void *p, size_t size, size_t n, FILE *f)
+{
+    size_t r = fread(p, size, n, f);
+    if (r != n && ferror(f)) {
+        die_errno("reading temporary file");
+    }
+    return r;
+}
+
+static void records_add(Records *R, Record r)
+{
+    if (R->size == R->capacity) {
+        R->data = x2realloc_or_die(R->data, &R->capacity, sizeof(Record));
+    }
+    R->data[R->size++] = r;
+}
+
+static void spill_write(size_t p, const Record *r, size_t n)
+{
+    pthread_mutex_lock(&spill_mutexes[p]);
+    fwrite_or_die(r, sizeof(Record), n, spill_files[p]);
+    pthread_mutex_unlock(&spill_mutexes[p]);
+}
+
+//-----------------------------------------------
+// Phase 1: splitting into lines, hashing, partitioning
+
+typedef struct {
+    int index;
+    size_t begin;
+    size_t end;
+} Range;
+
+static void *scan_worker(void *arg)
+{
+    const Range *range = arg;
+
+    Record (*bufs)[SPILL_BUF] = NULL;
+    size_t nbuf[NPARTITIONS] = {0};
+    if (spill) {
+        bufs = malloc_or_die(NPARTITIONS, sizeof(*bufs));
+    }
+
+    const char *p = input + range->begin;
+    const char *end = input + range->end;
+    while (p != end) {
+        const char *nl = memchr(p, '\n', end - p);
+        const char *line_end = nl ? nl : end;
+
+        Record r = {
+            .hash = jjhash64_b(p, line_end - p) & (UINT64_MAX << (64 - JJUNIQ_HASH_BITS)),
+            .off = p - input,
+            .len = line_end - p,
+        };
+        size_t part = r.hash >> (64 - PARTITION_BITS);
+        if (spill) {
+            bufs[part][nbuf[part]++] = r;
+            if (nbuf[part] == SPILL_BUF) {
+                spill_write(part, bufs[part], SPILL_BUF);
+                nbuf[part] = 0;
+            }
+        } else {
+            records_add(&records[range->index][part], r);
+        }
+
+        p = nl ? nl + 1 : end;
+    }
+
+    if (spill) {
+        for (size_t part = 0; part < NPARTITIONS; ++part) {
+            if (nbuf[part]) {
+                spill_write(part, bufs[part], nbuf[part]);
+            }
+        }
+        free(bufs);
+    }
+    return NULL;
+}
+
+// Counts the lines of a range, to decide whether to spill; 'arg' is a Range, and the count is stored into 'begin'.
+static void *count_worker(void *arg)
+{
+    Range *range = arg;
+    const char *p = input + range->begin;
+    const char *end = input + range->end;
+    size_t n = 0;
+    while (p != end) {
+        const char *nl = memchr(p, '\n', end - p);
+        ++n;
+        p = nl ? nl + 1 : end;
+    }
+    range->begin = n;
+    return NULL;
+}
+
+//-----------------------------------------------
+// Phase 2: deduplication of each partition
+
+static int compare_distinct(const void *a, const void *b)
+{
+    uint64_t x = ((const Distinct *) a)->off;
+    uint64_t y = ((const Distinct *) b)->off;
+    return (x > y) - (x < y);
+}
+
+// Open addressing, at most half full; grows with the number of distinct lines.
+typedef struct {
+    Distinct *slots;
+    size_t mask;
+    size_t n;
+} Table;
+
+static void table_init(Table *T, size_t capacity)
+{
+    *T = (Table) {.slots = calloc_or_die(capacity, sizeof(Distinct)), .mask = capacity - 1, .n = 0};
+}
+
+// The upper bits of the hash are the same within a partition, so the slot is picked with the lower ones.
+static Distinct *table_find_(Table *T, const Record *r)
+{
+    size_t i = r->hash & T->mask;
+    for (;; i = (i + 1) & T->mask) {
+        Distinct *d = &T->slots[i];
+        if (d->count == 0 ||
+                (d->hash == r->hash && d->len == r->len && memcmp(input + d->off, input + r->off, r->len) == 0)) {
+            return d;
+        }
+    }
+}
+
+static void table_grow_(Table *T)
+{
+    Table old = *T;
+    table_init(T, (old.mask + 1) * 2);
+    for (size_t i = 0; i <= old.mask; ++i) {
+        if (old.slots[i].count) {
+            size_t j = old.slots[i].hash & T->mask;
+            while (T->slots[j].count) {
+                j = (j + 1) & T->mask;
+            }
+            T->slots[j] = old.slots[i];
+        }
+    }
+    T->n = old.n;
+    free(old.slots);
+}
+
+// Returns false, leaving the table as is, if a new line would make it grow past 'max_capacity' slots.
+static bool table_add(Table *T, const Record *r, size_t max_capacity)
+{
+    Distinct *d = table_find_(T, r);
+    if (d->count) {
+        ++d->count;
+        if (d->off > r->off) {
+            d->off = r->off;
+        }
+        return true;
+    }
+    if ((T->n + 1) * 2 > T->mask + 1) {
+        if ((T->mask + 1) * 2 > max_capacity) {
+            return false;
+        }
+        table_grow_(T);
+        d = table_find_(T, r);
+    }
+    *d = (Distinct) {.hash = r->hash, .off = r->off, .len = r->len, .count = 1};
+    ++T->n;
+    return true;
+}
+
+// Distinct lines, ordered by first occurrence: in memory, or in a temporary file (for split partitions).
+typedef struct {
+    Distinct *data;
+    size_t n;
+    FILE *file;
+} Run;
+
+// Takes the lines out of the table, ordered by first occurrence.
+static Run table_run(Table *T)
+{
+    size_t n = 0;
+    for (size_t i = 0; i <= T->mask; ++i) {
+        if (T->slots[i].count) {
+            T->slots[n++] = T->slots[i];
+        }
+    }
+    qsort(T->slots, n, sizeof(Distinct), compare_distinct);
+    return (Run) {.data = T->slots, .n = n};
+}
+
+static void run_append(FILE *out, Run *r)
+{
+    if (!r->file) {
+        fwrite_or_die(r->data, sizeof(Distinct), r->n, out);
+        free(r->data);
+        return;
+    }
+    Distinct *chunk = malloc_or_die(READ_CHUNK, sizeof(Distinct));
+    rewind_or_die(r->file);
+    size_t n;
+    while ((n = fread_or_die(chunk, sizeof(Distinct), READ_CHUNK, r->file)) != 0) {
+        fwrite_or_die(chunk, sizeof(Distinct), n, out);
+    }
+    free(chunk);
+    fclose(r->file);
+}
+
+// Deduplicates the records in 'f' (and closes it), whose hashes share their upper 'nbits' bits. If the distinct lines do
+// not fit in the table budget, the records are split again by the next SUBPARTITION_BITS bits of their hashes, and each
+// of the sub-partitions is deduplicated in turn, into a temporary file. Once the bits run out, the budget is ignored.
+static Run dedup_file(FILE *f, int nbits)
+{
+    bool can_split = nbits + SUBPARTITION_BITS <= JJUNIQ_HASH_BITS;
+    size_t max_capacity = can_split ? table_budget / sizeof(Distinct) : SIZE_MAX;
+
+    Record *chunk = malloc_or_die(READ_CHUNK, sizeof(Record));
+    Table T;
+    table_init(&T, 16);
+    bool fits = true;
+    size_t n;
+    rewind_or_die(f);
+    while (fits && (n = fread_or_die(chunk, sizeof(Record), READ_CHUNK, f)) != 0) {
+        for (size_t i = 0; i < n && fits; ++i) {
+            fits = table_add(&T, &chunk[i], max_capacity);
+        }
+    }
+    if (fits) {
+        free(chunk);
+        fclose(f);
+        return table_run(&T);
+    }
+    free(T.slots);
+
+    FILE *subs[NSUBPARTITIONS];
+    for (int k = 0; k < NSUBPARTITIONS; ++k) {
+        subs[k] = tmpfile_or_die();
+    }
+    rewind_or_die(f);
+    while ((n = fread_or_die(chunk, sizeof(Record), READ_CHUNK, f)) != 0) {
+        for (size_t i = 0; i < n; ++i) {
+            size_t k = (chunk[i].hash << nbits) >> (64 - SUBPARTITION_BITS);
+            fwrite_or_die(&chunk[i], sizeof(Record), 1, subs[k]);
+        }
+    }
+    free(chunk);
+    fclose(f);
+
+    Run out = {.file = tmpfile_or_die()};
+    for (int k = 0; k < NSUBPARTITIONS; ++k) {
+        Run r = dedup_file(subs[k], nbits + SUBPARTITION_BITS);
+        run_append(out.file, &r);
+    }
+    return out;
+}
+
+static void print_distinct(const Distinct *d, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        if (print_counts) {
+            printf("%7" PRIu64 " ", d[i].count);
+        }
+        fwrite(input + d[i].off, 1, d[i].len, stdout);
+        putchar('\n');
+    }
+}
+
+static void print_partition(size_t part, Run *r)
+{
+    pthread_mutex_lock(&print_mutex);
+    while (next_to_print != part) {
+        pthread_cond_wait(&print_cond, &print_mutex);
+    }
+    if (!r->file) {
+        print_distinct(r->data, r->n);
+        free(r->data);
+    } else {
+        Distinct *chunk = malloc_or_die(READ_CHUNK, sizeof(Distinct));
+        rewind_or_die(r->file);
+        size_t n;
+        while ((n = fread_or_die(chunk, sizeof(Distinct), READ_CHUNK, r->file)) != 0) {
+            print_distinct(chunk, n);
+        }
+        free(chunk);
+        fclose(r->file);
+    }
+    ++next_to_print;
+    pthread_cond_broadcast(&print_cond);
+    pthread_mutex_unlock(&print_mutex);
+}
+
+static void dedup_partition(size_t part)
+{
+    if (spill) {
+        Run r = dedup_file(spill_files[part], PARTITION_BITS);
+        print_partition(part, &r);
+        return;
+    }
+
+    Table T;
+    table_init(&T, 16);
+    for (int t = 0; t < nthreads; ++t) {
+        Records *R = &records[t][part];
+        for (size_t i = 0; i < R->size; ++i) {
+            table_add(&T, &R->data[i], SIZE_MAX);
+        }
+        free(R->data);
+    }
+    Run r = table_run(&T);
+    print_partition(part, &r);
+}
+
+static void *dedup_worker(void *arg)
+{
+    (void) arg;
+    for (;;) {
+        size_t part = __atomic_fetch_add(&next_partition, 1, __ATOMIC_RELAXED);
+        if (part >= NPARTITIONS) {
+            break;
+        }
+        dedup_partition(part);
+    }
+    return NULL;
+}
+
+//-----------------------------------------------
+
+static void run_threads(void *(*func)(void *), void *args, size_t arg_size)
+{
+    pthread_t *threads = malloc_or_die(nthreads, sizeof(pthread_t));
+    for (int i = 0; i < nthreads; ++i) {
+        int err = pthread_create(&threads[i], NULL, func, (char *) args + i * arg_size);
+        if (err) {
+            errno = err;
+            die_errno("pthread_create");
+        }
+    }
+    for (int i = 0; i < nthreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
+
+static void map_input(int fd, const char *name)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        die_errno(name);
+    }
+    input_size = st.st_size;
+    if (input_size) {
+        void *p = mmap(NULL, input_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            die_errno(name);
+        }
+        madvise(p, input_size, MADV_SEQUENTIAL);
+        input = p;
+    }
+}
+
+static void read_input(const char *path)
+{
+    if (path) {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            die_errno(path);
+        }
+        map_input(fd, path);
+        close(fd);
+        return;
+    }
+
+    // A regular file at its beginning can be mapped as is.
+    struct stat st;
+    if (fstat(0, &st) == 0 && S_ISREG(st.st_mode) && lseek(0, 0, SEEK_CUR) == 0) {
+        map_input(0, "standard input");
+        return;
+    }
+
+    // Otherwise, the standard input is copied to a temporary file, so that it does not have to fit in memory.
+    enum { COPY_BUF = 1 << 20 };
+    char *buf = malloc_or_die(1, COPY_BUF);
+    FILE *f = tmpfile_or_die();
+    for (;;) {
+        ssize_t r = read(0, buf, COPY_BUF);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            die_errno("reading standard input");
+        }
+        if (r == 0) {
+            break;
+        }
+        fwrite_or_die(buf, 1, r, f);
+    }
+    free(buf);
+    if (fflush(f) != 0) {
+        die_errno("writing temporary file");
+    }
+    map_input(fileno(f), "temporary file");
+    // The mapping stays valid after the file is closed (and deleted).
+    fclose(f);
+}
+
+// Memory used to deduplicate 'nlines' lines without spilling: the records (twice their size, as arrays grow by
+// doubling), and the hash tables of the partitions deduplicated at once (4 slots per line at most, as they are at most
+// half full and their sizes are powers of 2), allowing partitions twice as large as the average.
+static uint64_t in_memory_bytes(uint64_t nlines)
+{
+    uint64_t records_bytes = nlines * 2 * sizeof(Record);
+    uint64_t lines_per_table = 2 * nlines / NPARTITIONS + 1;
+    uint64_t ntables = nthreads < NPARTITIONS ? (uint64_t) nthreads : NPARTITIONS;
+    uint64_t tables_bytes = ntables * lines_per_table * 4 * sizeof(Distinct);
+    return records_bytes + tables_bytes;
+}
+
+static void usage(void)
+{
+    fputs("USAGE: jjuniq [-c] [-j THREADS] [-m MEMORY_MIB] [FILE]\n", stderr);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    // By default, spill if deduplicating in memory would take more than half of the physical memory.
+    uint64_t mem_budget = (uint64_t) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE) / 2;
+
+    int c;
+    while ((c = getopt(argc, argv, "cj:m:")) != -1) {
+        switch (c) {
+        case 'c':
+            print_counts = true;
+            break;
+        case 'j':
+            nthreads = strtol(optarg, NULL, 10);
+            if (nthreads <= 0) {
+                usage();
+            }
+            break;
+        case 'm': {
+            char *end;
+            errno = 0;
+            unsigned long long mib = strtoull(optarg, &end, 10);
+            if (errno || end == optarg || *end || optarg[0] == '-' || mib > (UINT64_MAX >> 20)) {
+                usage();
+            }
+            mem_budget = (uint64_t) mib << 20;
+            break;
+        }
+        default:
+            usage();
+        }
+    }
+    if (argc - optind > 1) {
+        usage();
+    }
+    if (nthreads <= 0) {
+        nthreads = 1;
+    }
+
+    read_input(optind < argc ? argv[optind] : NULL);
+
+    static char stdout_buf[1 << 16];
+    setvbuf(stdout, stdout_buf, _IOFBF, sizeof(stdout_buf));
+
+    // Split the input between the threads at line boundaries.
+    Range *ranges = malloc_or_die(nthreads, sizeof(Range));
+    size_t begin = 0;
+    for (int i = 0; i < nthreads; ++i) {
+        size_t end = input_size / nthreads * (i + 1);
+        if (i == nthreads - 1 || end <= begin) {
+            end = i == nthreads - 1 ? input_size : begin;
+        } else {
+            const char *nl = memchr(input + end - 1, '\n', input_size - end + 1);
+            end = nl ? (size_t) (nl - input) + 1 : input_size;
+        }
+        ranges[i] = (Range) {.index = i, .begin = begin, .end = end};
+        begin = end;
+    }
+
+    // There are at most as many lines as bytes (plus one); count them only if that many might not fit.
+    if (in_memory_bytes(input_size + 1) > mem_budget) {
+        Range *counts = memdup_or_die(ranges, nthreads * sizeof(Range));
+        run_threads(count_worker, counts, sizeof(Range));
+        uint64_t nlines = 0;
+        for (int i = 0; i < nthreads; ++i) {
+            nlines += counts[i].begin;
+        }
+        free(counts);
+        spill = in_memory_bytes(nlines) > mem_budget;
+    }
+    // Each thread deduplicates one partition at a time.
+    table_budget = mem_budget / nthreads;
+    if (table_budget < JJUNIQ_MIN_TABLE_BUDGET) {
+        table_budget = JJUNIQ_MIN_TABLE_BUDGET;
+    }
+
+    if (spill) {
+        for (size_t p = 0; p < NPARTITIONS; ++p) {
+            spill_files[p] = tmpfile_or_die();
+            pthread_mutex_init(&spill_mutexes[p], NULL);
+        }
+    } else {
+        records = calloc_or_die(nthreads, sizeof(*records));
+    }
+
+    run_threads(scan_worker, ranges, sizeof(Range));
+    run_threads(dedup_worker, NULL, 0);
+
+    free(ranges);
+    free(records);
+    if (fflush(stdout) != 0) {
+        die_errno("writing output");
+    }
+    return 0;
+}
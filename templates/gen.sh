@@ -25,8 +25,94 @@ gen() {
     sed "${comments_rule}; s/@#/${suffix}/g; s/@T/${ctype}/g; s/@M/${mask}/g"
 }
 
+# Sizes to generate fixed-size hashers (jjhash_b_N) for.
+fixed_sizes=${JJHASH_FIXED_SIZES:-8 16 20 32}
+
+gen_fixed_funcs() {
+    local n
+    for n in $fixed_sizes; do
+        echo "static JJHASHF@#_ATTRS @T jjhash@#_b_$n(const char *s)"
+        echo "{"
+        echo "    uint64_t a = JJHASH@#_ACCUM_INIT;"
+        echo
+        local off
+        for (( off = 0; off + 4 <= n; off += 4 )); do
+            echo "    JJHASH@#_ACCUM_FEED(a, JJHASH@#_FETCH_LE32(s + $off));"
+        done
+        if (( n % 4 )); then
+            local v="(uint32_t) (uint8_t) s[$off]"
+            local i
+            for (( i = 1; off + i < n; ++i )); do
+                v="$v | ((uint32_t) (uint8_t) s[$(( off + i ))] << $(( i * 8 )))"
+            done
+            echo "    JJHASH@#_ACCUM_FEED(a, $v);"
+        fi
+        echo
+        echo "    JJHASH@#_ACCUM_FINALIZE(a);"
+        echo "@C    // Truncations are implementation-defined, so let's do masking."
+        echo "    return a@M;"
+        echo "}"
+        echo
+    done
+
+    echo "#ifdef __cplusplus"
+    echo
+    echo "template<size_t N>"
+    echo "inline @T jjhash@#_b_n(const char *s)"
+    echo "{"
+    echo "    return jjhash@#_b(s, N);"
+    echo "}"
+    for n in $fixed_sizes; do
+        echo
+        echo "template<>"
+        echo "inline @T jjhash@#_b_n<$n>(const char *s)"
+        echo "{"
+        echo "    return jjhash@#_b_$n(s);"
+        echo "}"
+    done
+    echo
+    echo "#endif // __cplusplus"
+}
+
+gen_fixed() {
+    sed '/^@@FIXED@@$/,$d' ./jjhashf.tmpl
+    gen_fixed_funcs
+    sed '1,/^@@FIXED@@$/d' ./jjhashf.tmpl
+}
+
+gen_fixed_validate_cases() {
+    echo "// Generated by templates/gen.sh; do not edit."
+    local n
+    for n in $fixed_sizes; do
+        echo "FIXED_SIZE($n)"
+    done
+}
+
 gen 32 < ./jjhash.tmpl  > ../jjhash.h
 gen 32 < ./jjhashx.tmpl > ../jjhashx.h
+gen 32 < ./jjhashv.tmpl > ../jjhashv.h
+gen 32 < ./jjhashd.tmpl > ../jjhashd.h
+gen_fixed | gen 32 > ../jjhashf.h
+gen 32 < ./jjhashiov.tmpl > ../jjhashiov.h
+gen 32 < ./jjhashp.tmpl > ../jjhashp.h
+gen 32 < ./jjhashr.tmpl > ../jjhashr.h
+gen 32 < ./jjhashcp.tmpl > ../jjhashcp.h
+gen 32 < ./jjhasha.tmpl > ../jjhasha.h
+gen 32 < ./jjhashl.tmpl > ../jjhashl.h
 
 gen 64 < ./jjhash.tmpl  > ../jjhash_64/jjhash64.h
 gen 64 < ./jjhashx.tmpl > ../jjhash_64/jjhashx64.h
+gen 64 < ./jjhashv.tmpl > ../jjhash_64/jjhashv64.h
+gen 64 < ./jjhashd.tmpl > ../jjhash_64/jjhashd64.h
+gen_fixed | gen 64 > ../jjhash_64/jjhashf64.h
+gen 64 < ./jjhashiov.tmpl > ../jjhash_64/jjhashiov64.h
+gen 64 < ./jjhashp.tmpl > ../jjhash_64/jjhashp64.h
+gen 64 < ./jjhashr.tmpl > ../jjhash_64/jjhashr64.h
+gen 64 < ./jjhashcp.tmpl > ../jjhash_64/jjhashcp64.h
+gen 64 < ./jjhasha.tmpl > ../jjhash_64/jjhasha64.h
+gen 64 < ./jjhashl.tmpl > ../jjhash_64/jjhashl64.h
+# The tree mode is only defined for 64-bit hashes.
+gen 64 < ./jjhasht.tmpl > ../jjhash_64/jjhasht64.h
+gen 64 < ./jjhashtp.tmpl > ../jjhash_64/jjhashtp64.h
+
+gen_fixed_validate_cases > ../validate/fixed_sizes.inc
@@ -59,6 +59,11 @@ size_t gen_word_len_almost_full(size_t max_len)
     return max_len - (prng_next(&prng) & 3);
 }
 
+size_t gen_word_len_uniform(size_t max_len)
+{
+    return prng_next(&prng) % (max_len + 1);
+}
+
 void gen_word(char *buf, size_t len)
 {
     static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
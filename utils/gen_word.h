@@ -35,4 +35,6 @@ size_t gen_word_len(size_t max_len);
 
 size_t gen_word_len_almost_full(size_t max_len);
 
+size_t gen_word_len_uniform(size_t max_len);
+
 void gen_word(char *buf, size_t len);
@@ -3,7 +3,26 @@
 set -e
 set -x
 
-for test_64 in 0 1; do
-    ${CC:-gcc} -Wall -Wextra -O3 -g3 -DTEST_64="$test_64" ./validate.c ../utils/*.c -o validate
-    ./validate
+# Each header must compile on its own in strict C99 and C++98; jjhashcp*.h also needs POSIX.1-2008 declarations.
+for header in ../*.h ../jjhash_64/*.h; do
+    posix=""
+    case "$header" in
+    *jjhashcp*) posix="-D_POSIX_C_SOURCE=200809L" ;;
+    esac
+    ${CC:-gcc} -std=c99 -pedantic -Wall -Wextra -Werror $posix -fsyntax-only -x c "$header" "$@"
+    ${CXX:-g++} -std=c++98 -pedantic -Wall -Wextra -Werror $posix -fsyntax-only -x c++ "$header" "$@"
 done
+
+split_mul="-DJJHASH_SPLIT_MUL=1 -DJJHASH64_SPLIT_MUL=1 -DJJHASHX_SPLIT_MUL=1 -DJJHASHX64_SPLIT_MUL=1"
+
+# The second round spells out the 32x32 multiplication split (see README.md), so that it is checked even
+# on 64-bit targets, where it is not the default.
+for extra in "" "$split_mul"; do
+    for test_64 in 0 1; do
+        ${CC:-gcc} -Wall -Wextra -O3 -g3 -pthread -DTEST_64="$test_64" $extra ./validate.c ../utils/*.c "$@" -o validate
+        ./validate
+    done
+done
+
+${CXX:-g++} -std=c++17 -Wall -Wextra -O3 -g3 ./validate_hpp.cpp "$@" -o validate_hpp
+./validate_hpp
@@ -27,6 +27,17 @@
 
 #include "../utils/common.h"
 #include "../utils/gen_word.h"
+#include "../utils/prng.h"
+
+// Strings shorter than these are hashed one by one by jjhash*_b_many(), and without the cache by
+// jjhashp*_b(); keep them well below the lengths of the test strings, so that both paths are tested.
+#define JJHASH_MANY_MIN_LEN 16
+#define JJHASH64_MANY_MIN_LEN 16
+#define JJHASHP_MIN_LEN 16
+#define JJHASHP64_MIN_LEN 16
+// Smaller than the default, so that more of the keys exceed it.
+#define JJHASHP_MAX_PREFIX 116
+#define JJHASHP64_MAX_PREFIX 116
 
 #include "../jjhash_64/jjhash64.h"
 #include "../jjhash_64/jjhashx64.h"
@@ -34,21 +45,73 @@
 #include "../jjhash.h"
 #include "../jjhashx.h"
 
+#include "../jjhash_64/jjhashv64.h"
+#include "../jjhashv.h"
+
+#include "../jjhash_64/jjhashd64.h"
+#include "../jjhashd.h"
+
+#include "../jjhash_64/jjhashf64.h"
+#include "../jjhashf.h"
+
+#include "../jjhash_64/jjhashiov64.h"
+#include "../jjhashiov.h"
+
+#include "../jjhash_64/jjhashp64.h"
+#include "../jjhashp.h"
+
+#include "../jjhash_64/jjhashr64.h"
+#include "../jjhashr.h"
+
+#include "../jjhash_64/jjhashcp64.h"
+#include "../jjhashcp.h"
+
+#include "../jjhash_64/jjhasha64.h"
+#include "../jjhasha.h"
+
+#include "../jjhash_64/jjhashl64.h"
+#include "../jjhashl.h"
+
+#include "../jjhash_64/jjhasht64.h"
+#include "../jjhash_64/jjhashtp64.h"
+
 #if TEST_64
 
 typedef uint64_t HASH_TYPE;
 # define HASH_TYPE_FMT PRIu64
 # define JJ(token)  jjhash64 ## token
+# define JJ_UP(token) JJHASH64 ## token
 # define JJX(token) jjhashx64 ## token
 # define JJX_UP(token) JJHASHX64 ## token
+# define JJV(token) jjhashv64 ## token
+# define JJV_UP(token) JJHASHV64 ## token
+# define JJD(token) jjhashd64 ## token
+# define JJP(token) jjhashp64 ## token
+# define JJR(token) jjhashr64 ## token
+# define JJCP(token) jjhashcp64 ## token
+# define JJA(token) jjhasha64 ## token
+# define JJL(token) jjhashl64 ## token
+# define JJA_UP(token) JJHASHA64 ## token
+# define JJCP_UP(token) JJHASHCP64 ## token
 
 #else
 
 typedef uint32_t HASH_TYPE;
 # define HASH_TYPE_FMT PRIu32
 # define JJ(token)  jjhash ## token
+# define JJ_UP(token) JJHASH ## token
 # define JJX(token) jjhashx ## token
 # define JJX_UP(token) JJHASHX ## token
+# define JJV(token) jjhashv ## token
+# define JJV_UP(token) JJHASHV ## token
+# define JJD(token) jjhashd ## token
+# define JJP(token) jjhashp ## token
+# define JJR(token) jjhashr ## token
+# define JJCP(token) jjhashcp ## token
+# define JJA(token) jjhasha ## token
+# define JJL(token) jjhashl ## token
+# define JJA_UP(token) JJHASHA ## token
+# define JJCP_UP(token) JJHASHCP ## token
 
 #endif
 
@@ -60,6 +123,8 @@ enum { W = 16 };
 enum { MAX_LEN = 256 };
 enum { TORTURE = 1024 };
 
+enum { MANY_N = 67 };
+
 typedef struct {
     char *page;
     size_t page_size;
@@ -73,8 +138,13 @@ typedef struct {
 enum {
     FLAG_OFFSET_FROM_END = 1 << 0,
     FLAG_ZERO_TERMINATE  = 1 << 1,
+    FLAG_SSE2            = 1 << 2,
+    FLAG_SHORT           = 1 << 3,
 };
 
+// Whether to also test the SSE2 kernels for null-terminated strings (FLAG_SSE2).
+static bool use_sse2 = false;
+
 static inline char *copy_by_offset(
     Page page,
     Content content,
@@ -106,10 +176,17 @@ static inline char *copy_by_offset(
     return dst;
 }
 
-static inline HASH_TYPE do_hash(const char *buf, size_t len, bool zero_terminated)
+static inline HASH_TYPE do_hash(const char *buf, size_t len, int flags)
 {
-    if (zero_terminated) {
+    if (flags & FLAG_ZERO_TERMINATE) {
+#if JJV_UP(_HAVE_SSE2)
+        if (flags & FLAG_SSE2) {
+            return JJV(_s_sse2)(buf);
+        }
+#endif
         return JJ(_s)(buf);
+    } else if (flags & FLAG_SHORT) {
+        return JJ(_b_short)(buf, len);
     } else {
         return JJ(_b)(buf, len);
     }
@@ -128,9 +205,15 @@ static HASH_TYPE test_content(
     int true_hash_flags = -1;
 
     for (size_t i = 0; i < W; ++i) {
-        for (int flags = 0; flags < 4; ++flags) {
+        for (int flags = 0; flags < 16; ++flags) {
+            if ((flags & FLAG_SSE2) && !(use_sse2 && (flags & FLAG_ZERO_TERMINATE))) {
+                continue;
+            }
+            if ((flags & FLAG_SHORT) && ((flags & FLAG_ZERO_TERMINATE) || content.len > JJ_UP(_SHORT_MAX))) {
+                continue;
+            }
             const char *ptr = copy_by_offset(page, content, i, flags);
-            HASH_TYPE hash = do_hash(ptr, content.len, !!(flags & FLAG_ZERO_TERMINATE));
+            HASH_TYPE hash = do_hash(ptr, content.len, flags);
             if (first) {
                 true_hash = hash;
                 first = false;
@@ -160,20 +243,28 @@ static struct JJX(_state) hash_state_of_concat_b(const char *s, size_t na, struc
     return JJX(_b_continue)(new_state, s + boundary, ntotal - boundary);
 }
 
-static struct JJX(_state) hash_state_of_concat_s(const char *s, size_t na, struct JJX(_state) state_a)
+static struct JJX(_state) hash_state_of_concat_s(const char *s, size_t na, struct JJX(_state) state_a, bool sse2)
 {
     size_t ntail = JJX_UP(_UNDO_TAIL_SIZE)(na);
     size_t boundary = JJX_UP(_UNDO_TRUNCATE_TAIL)(na);
 
     struct JJX(_state) new_state = JJX(_undo)(state_a, s + boundary, ntail);
 
+#if JJV_UP(_HAVE_SSE2)
+    if (sse2) {
+        return JJV(_s_continue_sse2)(new_state, s + boundary);
+    }
+#else
+    (void) sse2;
+#endif
     return JJX(_s_continue)(new_state, s + boundary);
 }
 
 static HASH_TYPE test_content_undo(
     Page page,
     Content content,
-    bool s_mode)
+    bool s_mode,
+    bool sse2)
 {
     const char *ptr = copy_by_offset(
         page, content, 0,
@@ -183,7 +274,7 @@ static HASH_TYPE test_content_undo(
 
     struct JJX(_state) state_A = JJX(_b_begin)(ptr, boundary);
     struct JJX(_state) state_AB = (s_mode
-        ? hash_state_of_concat_s(ptr, boundary, state_A)
+        ? hash_state_of_concat_s(ptr, boundary, state_A, sse2)
         : hash_state_of_concat_b(ptr, boundary, state_A, content.len)
     );
 
@@ -194,7 +285,7 @@ static HASH_TYPE test_content_undo(
     HASH_TYPE hash_undo = JJX(_finalize_state)(state_AB);
 
     if (hash_straight != hash_undo) {
-        fprintf(stderr, "Hash mismatch (undo, mode %c):\n", s_mode ? 's' : 'b');
+        fprintf(stderr, "Hash mismatch (undo, mode %c%s):\n", s_mode ? 's' : 'b', sse2 ? ", SSE2" : "");
 #define PAIR(ptr, len) (int) (len), (ptr)
         fprintf(
             stderr, "Content: '%.*s' + '%.*s'\n",
@@ -217,13 +308,615 @@ static HASH_TYPE test_on_string_of_length(
     gen_word(buf, len);
     Content content = {.buf = buf, .len = len};
     HASH_TYPE r1 = test_content(page, content);
-    HASH_TYPE r2 = test_content_undo(page, content, false);
+    HASH_TYPE r2 = test_content_undo(page, content, false, false);
     assert(r2 == r1);
-    HASH_TYPE r3 = test_content_undo(page, content, true);
+    HASH_TYPE r3 = test_content_undo(page, content, true, false);
     assert(r3 == r1);
+    if (use_sse2) {
+        HASH_TYPE r4 = test_content_undo(page, content, true, true);
+        assert(r4 == r1);
+    }
     return r1;
 }
 
+typedef void (*BatchFunc)(const char *const *ss, const size_t *nss, size_t n, HASH_TYPE *out);
+
+static void test_many(BatchFunc func, const char *name)
+{
+    static char bufs[MANY_N][MAX_LEN];
+    const char *ss[MANY_N];
+    size_t nss[MANY_N];
+    HASH_TYPE hashes[MANY_N];
+
+    for (int t = 0; t < TORTURE; ++t) {
+        // Alternate between wildly varying and almost equal lengths.
+        size_t max_len = (t & 1) ? MAX_LEN : (size_t) (t % MAX_LEN);
+        for (size_t i = 0; i < MANY_N; ++i) {
+            size_t len = (t & 1) ? gen_word_len(max_len) : gen_word_len_almost_full(max_len);
+            gen_word(bufs[i], len);
+            ss[i] = bufs[i];
+            nss[i] = len;
+        }
+
+        // Also check all the batch sizes that do not fill the last group of lanes.
+        size_t n = MANY_N - (t % 8);
+        func(ss, nss, n, hashes);
+
+        for (size_t i = 0; i < n; ++i) {
+            HASH_TYPE expected = JJ(_b)(ss[i], nss[i]);
+            if (hashes[i] != expected) {
+                fprintf(stderr, "Hash mismatch (%s, batch size %zu):\n", name, n);
+                fprintf(stderr, "Content: '%.*s'\n", (int) nss[i], ss[i]);
+                fprintf(stderr, "Hash (single): %" HASH_TYPE_FMT "\n", expected);
+                fprintf(stderr, "Hash (many):   %" HASH_TYPE_FMT "\n", hashes[i]);
+                abort();
+            }
+        }
+    }
+}
+
+typedef HASH_TYPE (*FixedSizeFunc)(const char *s);
+
+static void test_fixed_size(Page page, size_t n, FixedSizeFunc func)
+{
+    char buf[MAX_LEN];
+    assert(n <= MAX_LEN);
+
+    for (int t = 0; t < TORTURE; ++t) {
+        gen_word(buf, n);
+        Content content = {.buf = buf, .len = n};
+
+        for (size_t i = 0; i < W; ++i) {
+            const char *ptr = copy_by_offset(page, content, i, FLAG_OFFSET_FROM_END);
+            HASH_TYPE expected = JJ(_b)(ptr, n);
+            HASH_TYPE hash = func(ptr);
+            if (hash != expected) {
+                fprintf(stderr, "Hash mismatch (fixed size %zu, i=%zu):\n", n, i);
+                fprintf(stderr, "Content: '%.*s'\n", (int) n, ptr);
+                fprintf(stderr, "Hash (generic):    %" HASH_TYPE_FMT "\n", expected);
+                fprintf(stderr, "Hash (fixed size): %" HASH_TYPE_FMT "\n", hash);
+                abort();
+            }
+        }
+    }
+}
+
+static void test_stream(void)
+{
+    static char buf[MAX_LEN * 4];
+    PRNG prng;
+    prng_init(&prng, 2);
+
+    for (int t = 0; t < TORTURE * 16; ++t) {
+        size_t len = prng_next(&prng) % (sizeof(buf) + 1);
+        gen_word(buf, len);
+
+        // Small chunks (including empty ones) most of the time, so that the pending bytes get exercised.
+        struct JJX(_stream) st;
+        JJX(_stream_init)(&st);
+        for (size_t off = 0; off != len;) {
+            size_t max_chunk = (t & 1) ? 8 : (len - off);
+            size_t chunk = prng_next(&prng) % (max_chunk + 1);
+            if (chunk > len - off) {
+                chunk = len - off;
+            }
+            JJX(_stream_update)(&st, buf + off, chunk);
+            off += chunk;
+        }
+
+        HASH_TYPE expected = JJX(_b)(buf, len);
+        HASH_TYPE hash = JJX(_stream_final)(&st);
+        if (hash != expected) {
+            fprintf(stderr, "Hash mismatch (stream), length %zu:\n", len);
+            fprintf(stderr, "Hash (straight): %" HASH_TYPE_FMT "\n", expected);
+            fprintf(stderr, "Hash (stream):   %" HASH_TYPE_FMT "\n", hash);
+            abort();
+        }
+    }
+}
+
+static void test_prefix_index(void)
+{
+    enum { MAX_STEP = 8 };
+
+    static char buf[MAX_LEN * 4];
+    static struct JJX(_state) states[JJX_UP(_PREFIX_INDEX_NSTATES)(sizeof(buf), 1)];
+    PRNG prng;
+    prng_init(&prng, 4);
+
+    for (int t = 0; t < TORTURE; ++t) {
+        size_t len = prng_next(&prng) % (sizeof(buf) + 1);
+        size_t step = 1 + prng_next(&prng) % MAX_STEP;
+        gen_word(buf, len);
+
+        struct JJX(_prefix_index) idx;
+        JJX(_prefix_index_init)(&idx, buf, len, step, states);
+
+        for (size_t n = 0; n <= len; ++n) {
+            HASH_TYPE expected = JJX(_b)(buf, n);
+            HASH_TYPE hash = JJX(_prefix_index_hash)(&idx, n);
+            if (hash != expected) {
+                fprintf(stderr, "Hash mismatch (prefix index), length %zu, prefix %zu, step %zu:\n", len, n, step);
+                fprintf(stderr, "Hash (straight): %" HASH_TYPE_FMT "\n", expected);
+                fprintf(stderr, "Hash (index):    %" HASH_TYPE_FMT "\n", hash);
+                abort();
+            }
+        }
+    }
+}
+
+static void test_prefix_cache(void)
+{
+    enum { NCOMPONENTS = 8 };
+    enum { MAX_COMPONENT_LEN = 12 };
+    enum { MAX_COMPONENTS = 48 };
+    enum { NENTRIES = 64 };
+
+    // Few distinct components, so that the keys share prefixes; a small cache, so that entries get evicted;
+    // and up to MAX_COMPONENTS components, so that some keys exceed the maximum prefix length and depth.
+    static char components[NCOMPONENTS][MAX_COMPONENT_LEN];
+    static size_t component_lens[NCOMPONENTS];
+    static char buf[MAX_COMPONENTS * (MAX_COMPONENT_LEN + 1)];
+    static struct JJP(_entry) entries[NENTRIES];
+    PRNG prng;
+    prng_init(&prng, 5);
+
+    for (int i = 0; i < NCOMPONENTS; ++i) {
+        component_lens[i] = prng_next(&prng) % (MAX_COMPONENT_LEN + 1);
+        gen_word(components[i], component_lens[i]);
+    }
+
+    struct JJP(_cache) cache;
+    JJP(_init)(&cache, entries, NENTRIES, '/');
+
+    for (int t = 0; t < TORTURE * 64; ++t) {
+        size_t ncomponents = prng_next(&prng) % (MAX_COMPONENTS + 1);
+        if (t & 1) {
+            ncomponents %= 6;
+        }
+        size_t len = 0;
+        for (size_t i = 0; i < ncomponents; ++i) {
+            size_t c = prng_next(&prng) % NCOMPONENTS;
+            if (i != 0 || (t & 2)) {
+                buf[len++] = '/';
+            }
+            memcpy(buf + len, components[c], component_lens[c]);
+            len += component_lens[c];
+        }
+
+        HASH_TYPE expected = JJ(_b)(buf, len);
+        HASH_TYPE hash = JJP(_b)(&cache, buf, len);
+        if (hash != expected) {
+            fprintf(stderr, "Hash mismatch (prefix cache), key '%.*s':\n", (int) len, buf);
+            fprintf(stderr, "Hash (straight): %" HASH_TYPE_FMT "\n", expected);
+            fprintf(stderr, "Hash (cache):    %" HASH_TYPE_FMT "\n", hash);
+            abort();
+        }
+    }
+
+    if (cache.stats.hits == 0 || cache.stats.hits + cache.stats.short_keys == cache.stats.keys ||
+        cache.stats.short_keys == 0) {
+        fprintf(stderr, "Prefix cache: %" PRIu64 " hits and %" PRIu64 " short keys out of %" PRIu64 " keys, "
+                "expected some of each and some misses.\n", cache.stats.hits, cache.stats.short_keys, cache.stats.keys);
+        abort();
+    }
+}
+
+static void test_rope(void)
+{
+    enum { MAX_ROPE_LEN = 4096 };
+    enum { MAX_EDIT_LEN = 200 };
+    enum { MAX_EDITS_PER_HASH = 3 };
+
+    static char flat[MAX_ROPE_LEN + MAX_EDIT_LEN];
+    static char edit[MAX_EDIT_LEN];
+    static char readback[MAX_ROPE_LEN + MAX_EDIT_LEN];
+    PRNG prng;
+    prng_init(&prng, 6);
+
+    for (int t = 0; t < 64; ++t) {
+        // Small chunks, so that edits span, split and drop many of them.
+        size_t chunk_size = 4 + prng_next(&prng) % 61;
+        struct JJR(_buf) buf;
+        JJR(_init)(&buf, chunk_size);
+        size_t len = 0;
+
+        for (int e = 0; e < TORTURE; ++e) {
+            size_t min_pos = len;
+            size_t nedits = prng_next(&prng) % (MAX_EDITS_PER_HASH + 1);
+            for (size_t k = 0; k < nedits; ++k) {
+                size_t pos = prng_next(&prng) % (len + 1);
+                if (len < MAX_ROPE_LEN && (len == 0 || prng_next(&prng) % 2)) {
+                    size_t n = prng_next(&prng) % (MAX_EDIT_LEN + 1);
+                    // Mostly short edits near the end, like typing.
+                    if (prng_next(&prng) % 2) {
+                        n %= 3;
+                        pos = len - (len - pos) % 32;
+                    }
+                    gen_word(edit, n);
+                    if (JJR(_insert)(&buf, pos, edit, n) != 0) {
+                        die_out_of_memory();
+                    }
+                    memmove(flat + pos + n, flat + pos, len - pos);
+                    memcpy(flat + pos, edit, n);
+                    len += n;
+                } else {
+                    size_t n = prng_next(&prng) % (len - pos + 1);
+                    JJR(_erase)(&buf, pos, n);
+                    memmove(flat + pos, flat + pos + n, len - pos - n);
+                    len -= n;
+                }
+                if (min_pos > pos) {
+                    min_pos = pos;
+                }
+            }
+
+            size_t nrehashed;
+            HASH_TYPE expected = JJ(_b)(flat, len);
+            HASH_TYPE hash = JJR(_hash)(&buf, &nrehashed);
+            JJR(_read)(&buf, 0, len, readback);
+            if (JJR(_len)(&buf) != len || memcmp(readback, flat, len) != 0) {
+                fprintf(stderr, "Contents mismatch (rope), length %zu, chunk size %zu\n", len, chunk_size);
+                abort();
+            }
+            if (hash != expected) {
+                fprintf(stderr, "Hash mismatch (rope), length %zu, chunk size %zu:\n", len, chunk_size);
+                fprintf(stderr, "Hash (straight): %" HASH_TYPE_FMT "\n", expected);
+                fprintf(stderr, "Hash (rope):     %" HASH_TYPE_FMT "\n", hash);
+                abort();
+            }
+            // Only the chunk with the first edited byte and the ones after it may be rehashed.
+            if (nrehashed > len - min_pos + chunk_size) {
+                fprintf(stderr, "Rope rehashed %zu bytes after an edit at %zu (length %zu, chunk size %zu)\n",
+                        nrehashed, min_pos, len, chunk_size);
+                abort();
+            }
+        }
+
+        JJR(_free)(&buf);
+    }
+}
+
+static void test_columnar(void)
+{
+    enum { NROWS = 1000 };
+    enum { MAX_ROW_LEN = 40 };
+
+    static char data[NROWS * MAX_ROW_LEN];
+    static int32_t offsets32[NROWS + 1];
+    static int64_t offsets64[NROWS + 1];
+    static uint8_t validity[(NROWS + 7) / 8];
+    static HASH_TYPE hashes32[NROWS];
+    static HASH_TYPE hashes64[NROWS];
+    PRNG prng;
+    prng_init(&prng, 9);
+
+    for (int t = 0; t < 16; ++t) {
+        size_t off = 0;
+        for (size_t i = 0; i < NROWS; ++i) {
+            offsets32[i] = off;
+            offsets64[i] = off;
+            size_t len = prng_next(&prng) % (MAX_ROW_LEN + 1);
+            gen_word(data + off, len);
+            off += len;
+        }
+        offsets32[NROWS] = off;
+        offsets64[NROWS] = off;
+        for (size_t i = 0; i < sizeof(validity); ++i) {
+            validity[i] = (t & 1) ? prng_next(&prng) : 0xff;
+        }
+        const uint8_t *v = (t & 2) ? validity : NULL;
+
+        // Split the rows into a few ranges, as threads would.
+        size_t cut1 = prng_next(&prng) % (NROWS + 1);
+        size_t cut2 = cut1 + prng_next(&prng) % (NROWS - cut1 + 1);
+        size_t cuts[] = {0, cut1, cut2, NROWS};
+        for (int r = 0; r < 3; ++r) {
+            JJA(_b_i32)(data, offsets32, v, cuts[r], cuts[r + 1], hashes32 + cuts[r]);
+            JJA(_b_i64)(data, offsets64, v, cuts[r], cuts[r + 1], hashes64 + cuts[r]);
+        }
+
+        for (size_t i = 0; i < NROWS; ++i) {
+            bool valid = !v || ((v[i / 8] >> (i % 8)) & 1);
+            HASH_TYPE expected = valid ? JJ(_b)(data + offsets32[i], offsets32[i + 1] - offsets32[i]) : JJA_UP(_NULL_HASH);
+            if (hashes32[i] != expected || hashes64[i] != expected) {
+                fprintf(stderr, "Hash mismatch (columnar), row %zu%s:\n", i, valid ? "" : " (null)");
+                fprintf(stderr, "Hash (straight):       %" HASH_TYPE_FMT "\n", expected);
+                fprintf(stderr, "Hash (int32 offsets):  %" HASH_TYPE_FMT "\n", hashes32[i]);
+                fprintf(stderr, "Hash (int64 offsets):  %" HASH_TYPE_FMT "\n", hashes64[i]);
+                abort();
+            }
+        }
+    }
+}
+
+static void test_lookup(void)
+{
+    enum { N = 37 };
+    enum { BUCKET_SIZE = 24 };
+    enum { NBUCKETS = 64 };
+
+    static char table[NBUCKETS * BUCKET_SIZE];
+    static char words[N][MAX_LEN];
+    const char *ss[N];
+    size_t nss[N];
+    HASH_TYPE hashes[N];
+    PRNG prng;
+    prng_init(&prng, 10);
+
+    for (int t = 0; t < TORTURE; ++t) {
+        size_t n = prng_next(&prng) % (N + 1);
+        for (size_t i = 0; i < n; ++i) {
+            nss[i] = prng_next(&prng) % (MAX_LEN + 1);
+            gen_word(words[i], nss[i]);
+            ss[i] = words[i];
+        }
+        JJL(_b_prefetch)(ss, nss, n, table, BUCKET_SIZE, NBUCKETS - 1, hashes);
+        for (size_t i = 0; i < n; ++i) {
+            HASH_TYPE expected = JJ(_b)(ss[i], nss[i]);
+            const char *bucket = (const char *) JJL(_bucket)(table, BUCKET_SIZE, NBUCKETS - 1, hashes[i]);
+            if (hashes[i] != expected || bucket != table + (expected % NBUCKETS) * BUCKET_SIZE) {
+                fprintf(stderr, "Hash mismatch (lookup), key %zu of %zu:\n", i, n);
+                fprintf(stderr, "Hash (straight):  %" HASH_TYPE_FMT "\n", expected);
+                fprintf(stderr, "Hash (prefetch):  %" HASH_TYPE_FMT "\n", hashes[i]);
+                fprintf(stderr, "Bucket offset:    %zu\n", (size_t) (bucket - table));
+                abort();
+            }
+        }
+    }
+}
+
+static void test_checkpoint(void)
+{
+    enum { NAPPENDS = 64 };
+    enum { MAX_APPEND = 3000 };
+
+    static char buf[NAPPENDS * MAX_APPEND];
+    PRNG prng;
+    prng_init(&prng, 8);
+
+    // Serialization: round trips, and every corrupted byte is detected.
+    for (int t = 0; t < TORTURE; ++t) {
+        size_t len = prng_next(&prng) % (MAX_LEN + 1);
+        gen_word(buf, len);
+        struct JJX(_stream) st;
+        JJX(_stream_init)(&st);
+        JJX(_stream_update)(&st, buf, len);
+
+        unsigned char cp[JJX_UP(_CHECKPOINT_SIZE)];
+        JJX(_checkpoint_save)(&st, len, cp);
+
+        struct JJX(_stream) st2;
+        uint64_t len2;
+        if (JJX(_checkpoint_load)(cp, &st2, &len2) != 0 || len2 != len
+                || JJX(_stream_final)(&st2) != JJX(_b)(buf, len)) {
+            fprintf(stderr, "Checkpoint round trip failed, length %zu\n", len);
+            abort();
+        }
+
+        size_t pos = prng_next(&prng) % sizeof(cp);
+        cp[pos] ^= 1 + prng_next(&prng) % 255;
+        if (JJX(_checkpoint_load)(cp, &st2, &len2) == 0) {
+            fprintf(stderr, "Corrupted checkpoint (byte %zu) was loaded, length %zu\n", pos, len);
+            abort();
+        }
+    }
+
+    // Files: resume after each append, from the checkpoint saved after the previous one.
+    char path[] = "/tmp/jjhash_validate_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        abort();
+    }
+    char *cp_path = allocf_or_die("%s.jjcp", path);
+
+    struct JJX(_stream) st;
+    JJX(_stream_init)(&st);
+    uint64_t length = 0;
+    size_t len = 0;
+    for (int a = 0; a < NAPPENDS; ++a) {
+        size_t n = prng_next(&prng) % (MAX_APPEND + 1);
+        gen_word(buf + len, n);
+        if (pwrite(fd, buf + len, n, len) != (ssize_t) n) {
+            perror("pwrite");
+            abort();
+        }
+        len += n;
+
+        if (JJCP(_save_file)(cp_path, &st, length) != 0 || JJCP(_load_file)(cp_path, &st, &length) != 0) {
+            fprintf(stderr, "Cannot save or load checkpoint file\n");
+            abort();
+        }
+        if (JJCP(_resume)(fd, &st, &length) != 0 || length != len) {
+            fprintf(stderr, "Cannot resume from checkpoint, length %zu\n", len);
+            abort();
+        }
+        HASH_TYPE expected = JJX(_b)(buf, len);
+        HASH_TYPE hash = JJX(_stream_final)(&st);
+        if (hash != expected || JJCP(_verify)(fd, &st, length) != 0) {
+            fprintf(stderr, "Hash mismatch (checkpoint), length %zu:\n", len);
+            fprintf(stderr, "Hash (straight): %" HASH_TYPE_FMT "\n", expected);
+            fprintf(stderr, "Hash (resumed):  %" HASH_TYPE_FMT "\n", hash);
+            abort();
+        }
+    }
+
+    // A rewritten prefix is caught by verification, and a truncated file by resumption.
+    if (len != 0) {
+        char c = buf[len / 2] ^ 1;
+        if (pwrite(fd, &c, 1, len / 2) != 1) {
+            perror("pwrite");
+            abort();
+        }
+        if (JJCP(_verify)(fd, &st, length) != JJCP_UP(_MISMATCH)) {
+            fprintf(stderr, "Checkpoint verification missed a rewritten byte\n");
+            abort();
+        }
+        if (ftruncate(fd, len - 1) != 0) {
+            perror("ftruncate");
+            abort();
+        }
+        if (JJCP(_resume)(fd, &st, &length) != JJCP_UP(_MISMATCH)) {
+            fprintf(stderr, "Checkpoint resumption missed a truncation\n");
+            abort();
+        }
+    }
+
+    close(fd);
+    unlink(path);
+    unlink(cp_path);
+    free(cp_path);
+}
+
+static void put_le64(char *p, uint64_t x)
+{
+    for (int i = 0; i < 8; ++i) {
+        p[i] = x >> (8 * i);
+    }
+}
+
+// The tree mode is only defined for 64-bit hashes, so this does not depend on TEST_64.
+static void test_tree(void)
+{
+    enum { CHUNK = JJHASHT64_CHUNK_SIZE };
+    enum { MAX_NLEAVES = 4 };
+    enum { MAX_THREADS = 5 };
+
+    static char buf[MAX_NLEAVES * CHUNK];
+    static char combined[4 + 8 * MAX_NLEAVES + 8];
+    static const size_t lens[] = {
+        0, 1, 3, 4, 5, CHUNK - 1, CHUNK, CHUNK + 1, CHUNK + 4, 2 * CHUNK, 3 * CHUNK + 5, 4 * CHUNK - 3, 4 * CHUNK,
+    };
+    PRNG prng;
+    prng_init(&prng, 7);
+
+    gen_word(buf, sizeof(buf));
+
+    for (size_t t = 0; t < array_size(lens); ++t) {
+        size_t len = lens[t];
+
+        // Reference: straight from the definition.
+        size_t nleaves = (len + CHUNK - 1) / CHUNK;
+        memcpy(combined, "JJT1", 4);
+        for (size_t i = 0; i < nleaves; ++i) {
+            size_t off = i * CHUNK;
+            put_le64(combined + 4 + 8 * i, jjhash64_b(buf + off, len - off < CHUNK ? len - off : CHUNK));
+        }
+        put_le64(combined + 4 + 8 * nleaves, len);
+        uint64_t expected = jjhash64_b(combined, 4 + 8 * nleaves + 8);
+
+        uint64_t hashes[2 + MAX_THREADS];
+        const char *names[2 + MAX_THREADS];
+        size_t nhashes = 0;
+
+        names[nhashes] = "serial";
+        hashes[nhashes++] = jjhasht64_b(buf, len);
+
+        struct jjhasht64_stream st;
+        jjhasht64_stream_init(&st);
+        for (size_t off = 0; off != len;) {
+            size_t chunk = prng_next(&prng) % (CHUNK / 3);
+            if (chunk > len - off) {
+                chunk = len - off;
+            }
+            jjhasht64_stream_update(&st, buf + off, chunk);
+            off += chunk;
+        }
+        names[nhashes] = "stream";
+        hashes[nhashes++] = jjhasht64_stream_final(&st);
+
+        for (unsigned nthreads = 1; nthreads <= MAX_THREADS; ++nthreads) {
+            names[nhashes] = "threaded";
+            hashes[nhashes++] = jjhashtp64_b(buf, len, nthreads);
+        }
+
+        for (size_t i = 0; i < nhashes; ++i) {
+            if (hashes[i] != expected) {
+                fprintf(stderr, "Hash mismatch (tree, %s), length %zu:\n", names[i], len);
+                fprintf(stderr, "Hash (definition): %" PRIu64 "\n", expected);
+                fprintf(stderr, "Hash (%s): %" PRIu64 "\n", names[i], hashes[i]);
+                abort();
+            }
+        }
+    }
+}
+
+static void test_iov(void)
+{
+    enum { MAX_SEGMENTS = 16 };
+
+    static char buf[MAX_LEN * 4];
+    PRNG prng;
+    prng_init(&prng, 3);
+
+    for (int t = 0; t < TORTURE * 16; ++t) {
+        size_t len = prng_next(&prng) % (sizeof(buf) + 1);
+        gen_word(buf, len);
+
+        // Cut into random segments, some of which may be empty.
+        struct iovec iov[MAX_SEGMENTS];
+        int iovcnt = 1 + prng_next(&prng) % MAX_SEGMENTS;
+        size_t off = 0;
+        for (int i = 0; i < iovcnt; ++i) {
+            size_t seg_len = (i == iovcnt - 1) ? (len - off) : prng_next(&prng) % (len - off + 1);
+            iov[i].iov_base = buf + off;
+            iov[i].iov_len = seg_len;
+            off += seg_len;
+        }
+
+        // Also check the continuation from a state whose length is a multiple of 4.
+        size_t prefix = JJX_UP(_UNDO_TRUNCATE_TAIL)(iov[0].iov_len);
+        struct JJX(_state) prefix_state = JJX(_b_begin)(buf, prefix);
+        iov[0].iov_base = buf + prefix;
+        iov[0].iov_len -= prefix;
+
+        HASH_TYPE expected = JJX(_b)(buf, len);
+        HASH_TYPE hash_continue = JJX(_finalize_state)(JJX(_iov_continue)(prefix_state, iov, iovcnt));
+        iov[0].iov_base = buf;
+        iov[0].iov_len += prefix;
+        HASH_TYPE hash = JJ(_iov)(iov, iovcnt);
+        if (hash != expected || hash_continue != expected) {
+            fprintf(stderr, "Hash mismatch (iov), length %zu, %d segments:\n", len, iovcnt);
+            fprintf(stderr, "Hash (straight): %" HASH_TYPE_FMT "\n", expected);
+            fprintf(stderr, "Hash (iov):      %" HASH_TYPE_FMT "\n", hash);
+            fprintf(stderr, "Hash (continue): %" HASH_TYPE_FMT "\n", hash_continue);
+            abort();
+        }
+    }
+}
+
+static void test_integers(void)
+{
+    PRNG prng;
+    prng_init(&prng, 1);
+
+    for (int t = 0; t < TORTURE * TORTURE; ++t) {
+        uint64_t x = prng_next(&prng);
+        // Also test small values, so that the high bytes are zero.
+        if (t & 1) {
+            x >>= (t >> 1) % 64;
+        }
+
+        char bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = (char) (uint8_t) (x >> (8 * i));
+        }
+
+        HASH_TYPE expected_32 = JJ(_b)(bytes, 4);
+        HASH_TYPE expected_64 = JJ(_b)(bytes, 8);
+        HASH_TYPE hash_32 = JJ(_u32)((uint32_t) (x & 0xffffffff));
+        HASH_TYPE hash_64 = JJ(_u64)(x);
+        if (hash_32 != expected_32 || hash_64 != expected_64) {
+            fprintf(stderr, "Hash mismatch (integers):\n");
+            fprintf(stderr, "Value: %" PRIu64 "\n", x);
+            fprintf(stderr, "Hash (u32): %" HASH_TYPE_FMT ", expected %" HASH_TYPE_FMT "\n", hash_32, expected_32);
+            fprintf(stderr, "Hash (u64): %" HASH_TYPE_FMT ", expected %" HASH_TYPE_FMT "\n", hash_64, expected_64);
+            abort();
+        }
+    }
+}
+
 static Page alloc_page_or_die(void)
 {
 #ifdef _SC_PAGESIZE
@@ -307,6 +1000,11 @@ int main(int argc, char **argv)
 
     gen_word_global_init();
 
+#if JJV_UP(_HAVE_SSE2)
+    use_sse2 = __builtin_cpu_supports("sse2");
+#endif
+    fprintf(stderr, "Testing SSE2 kernels: %s\n", use_sse2 ? "yes" : "no");
+
     HASH_TYPE xored_hashes = 0;
     char buf[MAX_LEN];
 
@@ -317,5 +1015,65 @@ int main(int argc, char **argv)
         }
     }
 
+    fprintf(stderr, "Testing batch hashing\n");
+    test_many(JJ(_b_many), "many");
+
+#if JJV_UP(_HAVE_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        fprintf(stderr, "Testing batch hashing (AVX2)\n");
+        test_many(JJV(_b_many_avx2), "many_avx2");
+    } else {
+        fprintf(stderr, "Skipping batch hashing (AVX2): not supported by the CPU\n");
+    }
+#endif
+
+#if JJV_UP(_HAVE_AVX512)
+    if (__builtin_cpu_supports("avx512f")) {
+        fprintf(stderr, "Testing batch hashing (AVX-512)\n");
+        test_many(JJV(_b_many_avx512), "many_avx512");
+    } else {
+        fprintf(stderr, "Skipping batch hashing (AVX-512): not supported by the CPU\n");
+    }
+#endif
+
+    fprintf(stderr, "Testing batch hashing (dispatched, kernel: %s)\n", JJD(_kernel_name)());
+    test_many(JJD(_b_many), "many_dispatched");
+
+    fprintf(stderr, "Testing streams\n");
+    test_stream();
+
+    fprintf(stderr, "Testing prefix index\n");
+    test_prefix_index();
+
+    fprintf(stderr, "Testing prefix cache\n");
+    test_prefix_cache();
+
+    fprintf(stderr, "Testing rope\n");
+    test_rope();
+
+    fprintf(stderr, "Testing columnar batches\n");
+    test_columnar();
+
+    fprintf(stderr, "Testing hashing with bucket prefetch\n");
+    test_lookup();
+
+    fprintf(stderr, "Testing checkpoints\n");
+    test_checkpoint();
+
+    fprintf(stderr, "Testing tree mode\n");
+    test_tree();
+
+    fprintf(stderr, "Testing scatter-gather arrays\n");
+    test_iov();
+
+    fprintf(stderr, "Testing integers\n");
+    test_integers();
+
+#define FIXED_SIZE(N) \
+    fprintf(stderr, "Testing fixed size %d\n", N); \
+    test_fixed_size(page, N, JJ(_b_ ## N));
+#include "fixed_sizes.inc"
+#undef FIXED_SIZE
+
     fprintf(stderr, "OK, xored_hashes=%" HASH_TYPE_FMT "\n", xored_hashes);
 }
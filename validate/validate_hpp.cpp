@@ -0,0 +1,71 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+ */
+
+// Checks that the C++ interface (jjhash.hpp) agrees with the C headers at run time; the compile-time
+// checks are in jjhash.hpp itself.
+
+#include "../jjhash.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+enum { MAX_LEN = 256 };
+enum { TORTURE = 1024 };
+
+int main()
+{
+    std::mt19937_64 rng(1);
+    char buf[MAX_LEN + 1];
+
+    for (size_t len = 0; len <= MAX_LEN; ++len) {
+        for (int t = 0; t < TORTURE; ++t) {
+            for (size_t i = 0; i < len; ++i) {
+                // Any non-zero byte, so that the 'const char *' overload of the hasher sees all of them.
+                buf[i] = static_cast<char>(1 + rng() % 255);
+            }
+            buf[len] = '\0';
+
+            jjhash::hasher h;
+            std::string str(buf, len);
+
+            bool ok = jjhash::b(buf, len) == jjhash_b(buf, len)
+                   && jjhash::b64(buf, len) == jjhash64_b(buf, len)
+                   && h(buf) == h(str);
+#if __cplusplus >= 201703L
+            ok = ok && h(std::string_view(buf, len)) == h(str);
+#endif
+            if (!ok) {
+                std::fprintf(stderr, "Hash mismatch (C++), content: '%s'\n", buf);
+                std::abort();
+            }
+        }
+    }
+
+    std::fprintf(stderr, "OK (C++)\n");
+}